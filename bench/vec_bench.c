@@ -0,0 +1,515 @@
+/**
+ * @file vec_bench.c
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Micro and macro benchmarks of vectors and svecs
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ * Runs every case over item sizes and lengths from 10 up to --max-length
+ * (powers of ten) and reports, per operation: wall time, bytes and number of
+ * allocations made through a counting allocator, and cache misses from
+ * perf_event_open when the kernel allows it. Results go to stdout (or
+ * --out) as JSON and to stderr as a table. Inputs come from a fixed seed, so
+ * runs are reproducible.
+ *
+ * usage: vec_bench [--max-length N] [--ops N] [--filter TEXT] [--out FILE]
+ *
+ */
+
+#define _GNU_SOURCE
+#include "vec.h"
+#include "vec_sort.h"
+#include "wtfc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_SEED 0x9e3779b97f4a7c15u
+#define BENCH_MIN_REPS 3
+#define BENCH_MAX_ITEM 64
+
+// counting allocator
+
+/**
+ * @struct bench_counts
+ * @brief Allocations made through the counting allocator.
+ */
+struct bench_counts {
+  mut_usz bytes; /**< Bytes requested by allocations and reallocations. */
+  mut_usz count; /**< Number of allocations and reallocations. */
+};
+
+static void *count_allocate(void *ctx, usz size) {
+  struct bench_counts *counts = ctx;
+  counts->bytes += size;
+  counts->count += 1;
+  return malloc(size);
+}
+
+static void *count_reallocate(void *ctx, void *ptr, usz old_size,
+                              usz new_size) {
+  struct bench_counts *counts = ctx;
+  (void)old_size;
+  counts->bytes += new_size;
+  counts->count += 1;
+  return realloc(ptr, new_size);
+}
+
+static void count_release(void *ctx, void *ptr, usz size) {
+  (void)ctx;
+  (void)size;
+  free(ptr);
+}
+
+static struct bench_counts counts;
+static vec_allocator counting = {.allocate = count_allocate,
+                                 .reallocate = count_reallocate,
+                                 .release = count_release,
+                                 .ctx = &counts};
+
+// cache miss counter
+
+static int perf_fd = -1;
+
+static void perf_open(void) {
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof attr;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  perf_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static void perf_start(void) {
+#ifdef __linux__
+  if (perf_fd >= 0) {
+    ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+static mut_u64 perf_stop(void) {
+  mut_u64 value = 0;
+#ifdef __linux__
+  if (perf_fd >= 0) {
+    ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(perf_fd, &value, sizeof value) != (ssize_t)sizeof value) {
+      value = 0;
+    }
+  }
+#endif
+  return value;
+}
+
+static mut_u64 now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000u + (u64)ts.tv_nsec;
+}
+
+// cases
+
+/**
+ * @struct bench_ctx
+ * @brief The parameters of one measurement and the state of its case.
+ */
+struct bench_ctx {
+  mut_usz length;    /**< The number of items. */
+  mut_usz item_size; /**< The size of an item. */
+  bool flat;         /**< Flat or pointer mode. */
+  mut_vec self;      /**< The vector of vec cases. */
+  void *svec;        /**< The svec of svec cases. */
+  vec_item *items;   /**< Items to push in pointer mode. */
+  mut_u64 *keys;     /**< Keys of the sort cases. */
+  mut_u64 rng;       /**< The random state. */
+  mut_u64 sink;      /**< Keeps results alive. */
+  mut_u8 item[BENCH_MAX_ITEM]; /**< The item pushed in flat mode. */
+};
+
+static mut_u64 next_random(struct bench_ctx *ctx) {
+  ctx->rng ^= ctx->rng << 13;
+  ctx->rng ^= ctx->rng >> 7;
+  ctx->rng ^= ctx->rng << 17;
+  return ctx->rng;
+}
+
+static mut_usz random_index(struct bench_ctx *ctx) {
+  return (usz)(next_random(ctx) % ctx->length);
+}
+
+static struct vec_interface bench_interface(struct bench_ctx const *ctx,
+                                            enum vec_growth growth) {
+  return (struct vec_interface){.item_size = ctx->item_size,
+                                .destroy = ctx->flat ? NULL : free,
+                                .flat = ctx->flat,
+                                .allocator = &counting,
+                                .growth = growth};
+}
+
+static vec_item new_item(struct bench_ctx *ctx) {
+  vec_item item = malloc(ctx->item_size);
+  if (item == NULL) {
+    fprintf(stderr, "%s:%d - out of memory\n", __FILE__, __LINE__);
+    exit(1);
+  }
+  memset(item, 0x5a, ctx->item_size);
+  return item;
+}
+
+/**
+ * @brief Returns the item pushed at an index: a fresh allocation in pointer
+ * mode, the shared template in flat mode.
+ */
+static vec_item push_item(struct bench_ctx *ctx, usz index) {
+  return ctx->flat ? (vec_item)ctx->item : ctx->items[index];
+}
+
+static void setup_items(struct bench_ctx *ctx) {
+  memset(ctx->item, 0x5a, sizeof ctx->item);
+  if (!ctx->flat) {
+    ctx->items = malloc(sizeof *ctx->items * ctx->length);
+    if (ctx->items == NULL) {
+      fprintf(stderr, "%s:%d - out of memory\n", __FILE__, __LINE__);
+      exit(1);
+    }
+    for (mut_usz i = 0; i < ctx->length; ++i) {
+      ctx->items[i] = new_item(ctx);
+    }
+  }
+}
+
+static void setup_empty(struct bench_ctx *ctx, enum vec_growth growth) {
+  setup_items(ctx);
+  ctx->self = vec_init(bench_interface(ctx, growth));
+}
+
+static void setup_empty_double(struct bench_ctx *ctx) {
+  setup_empty(ctx, VEC_GROW_DOUBLE);
+}
+
+static void setup_empty_half(struct bench_ctx *ctx) {
+  setup_empty(ctx, VEC_GROW_HALF);
+}
+
+static void setup_empty_page(struct bench_ctx *ctx) {
+  setup_empty(ctx, VEC_GROW_PAGE);
+}
+
+static void setup_reserved(struct bench_ctx *ctx) {
+  setup_items(ctx);
+  ctx->self = vec_with_capacity(bench_interface(ctx, VEC_GROW_DOUBLE),
+                                ctx->length);
+}
+
+static void setup_filled(struct bench_ctx *ctx) {
+  setup_empty_double(ctx);
+  for (mut_usz i = 0; i < ctx->length; ++i) {
+    vec_push(ctx->self, push_item(ctx, i));
+  }
+}
+
+static void setup_svec_empty(struct bench_ctx *ctx) {
+  memset(ctx->item, 0x5a, sizeof ctx->item);
+  ctx->svec = _svec_init_with(ctx->item_size, &counting);
+}
+
+static void setup_svec_filled(struct bench_ctx *ctx) {
+  setup_svec_empty(ctx);
+  for (mut_usz i = 0; i < ctx->length; ++i) {
+    ctx->svec = _svec_push(ctx->svec, ctx->item);
+  }
+}
+
+static void setup_keys(struct bench_ctx *ctx) {
+  ctx->keys = malloc(sizeof *ctx->keys * ctx->length);
+  if (ctx->keys == NULL) {
+    fprintf(stderr, "%s:%d - out of memory\n", __FILE__, __LINE__);
+    exit(1);
+  }
+  for (mut_usz i = 0; i < ctx->length; ++i) {
+    ctx->keys[i] = next_random(ctx);
+  }
+}
+
+static void teardown(struct bench_ctx *ctx) {
+  if (ctx->self != NULL) {
+    vec_destroy(ctx->self);
+  } else if (!ctx->flat && ctx->items != NULL) {
+    for (mut_usz i = 0; i < ctx->length; ++i) {
+      free(ctx->items[i]);
+    }
+  }
+  if (ctx->svec != NULL) {
+    svec_destroy(ctx->svec);
+  }
+  free(ctx->items);
+  free(ctx->keys);
+  ctx->self = NULL;
+  ctx->svec = NULL;
+  ctx->items = NULL;
+  ctx->keys = NULL;
+}
+
+static void run_push(struct bench_ctx *ctx) {
+  for (mut_usz i = 0; i < ctx->length; ++i) {
+    vec_push(ctx->self, push_item(ctx, i));
+  }
+}
+
+static void run_svec_push(struct bench_ctx *ctx) {
+  for (mut_usz i = 0; i < ctx->length; ++i) {
+    ctx->svec = _svec_push(ctx->svec, ctx->item);
+  }
+}
+
+static void sum_item(void *ctx, vec_item item) {
+  struct bench_ctx *bench = ctx;
+  mut_u8 first;
+  memcpy(&first, item, sizeof first);
+  bench->sink += first;
+}
+
+static void touch_item(void *ctx, vec_item item) {
+  struct bench_ctx *bench = ctx;
+  mut_u8 *bytes = item;
+  bytes[0] = (mut_u8)(bytes[0] + 1);
+  bench->sink += bytes[0];
+}
+
+static void run_foreach(struct bench_ctx *ctx) {
+  vec_foreach_ctx(ctx->self, sum_item, ctx);
+}
+
+static void run_random_modify(struct bench_ctx *ctx) {
+  for (mut_usz i = 0; i < ctx->length; ++i) {
+    vec_modify_ctx(ctx->self, random_index(ctx), touch_item, ctx);
+  }
+}
+
+static void run_svec_sequential(struct bench_ctx *ctx) {
+  mut_u8 *data = (mut_u8 *)((struct _svec_mdi *)ctx->svec + 1);
+  for (mut_usz i = 0; i < ctx->length; ++i) {
+    ctx->sink += data[i * ctx->item_size];
+  }
+}
+
+static void run_svec_random(struct bench_ctx *ctx) {
+  mut_u8 *data = (mut_u8 *)((struct _svec_mdi *)ctx->svec + 1);
+  for (mut_usz i = 0; i < ctx->length; ++i) {
+    ctx->sink += data[random_index(ctx) * ctx->item_size];
+  }
+}
+
+static void run_copy_write(struct bench_ctx *ctx) {
+  mut_vec copy = vec_copy(ctx->self);
+  vec_modify_ctx(copy, 0, touch_item, ctx);
+  vec_destroy(copy);
+}
+
+static void run_slice(struct bench_ctx *ctx) {
+  mut_vec slice = vec_slice(ctx->self, 0, ctx->length);
+  vec_destroy(slice);
+}
+
+static void run_sort_u64(struct bench_ctx *ctx) {
+  vec_sort_u64(ctx->keys, ctx->length);
+  ctx->sink += ctx->keys[0];
+}
+
+/**
+ * @struct bench_case
+ * @brief A benchmark: a setup, the measured operation and its modes.
+ */
+struct bench_case {
+  char const *name;    /**< The name of the case. */
+  char const *pattern; /**< The access pattern. */
+  char const *mode;    /**< "flat", "pointer", "svec" or "array". */
+  mut_usz fixed_size;  /**< The only item size, 0 for all sizes. */
+  void (*setup)(struct bench_ctx *ctx); /**< Prepares a measurement. */
+  void (*run)(struct bench_ctx *ctx);   /**< The measured operation. */
+};
+
+static struct bench_case const cases[] = {
+    {"vec_push", "append", "flat", 0, setup_empty_double, run_push},
+    {"vec_push", "append", "pointer", 0, setup_empty_double, run_push},
+    {"vec_push_grow_half", "append", "flat", 0, setup_empty_half, run_push},
+    {"vec_push_grow_page", "append", "flat", 0, setup_empty_page, run_push},
+    {"vec_push_reserved", "append", "flat", 0, setup_reserved, run_push},
+    {"_svec_push", "append", "svec", 0, setup_svec_empty, run_svec_push},
+    {"vec_foreach", "sequential", "flat", 0, setup_filled, run_foreach},
+    {"vec_foreach", "sequential", "pointer", 0, setup_filled, run_foreach},
+    {"vec_modify", "random", "flat", 0, setup_filled, run_random_modify},
+    {"svec_read", "sequential", "svec", 0, setup_svec_filled,
+     run_svec_sequential},
+    {"svec_read", "random", "svec", 0, setup_svec_filled, run_svec_random},
+    {"vec_copy_write", "sequential", "flat", 0, setup_filled, run_copy_write},
+    {"vec_copy_write", "sequential", "pointer", 0, setup_filled,
+     run_copy_write},
+    {"vec_slice", "sequential", "flat", 0, setup_filled, run_slice},
+    {"vec_slice", "sequential", "pointer", 0, setup_filled, run_slice},
+    {"vec_sort_u64", "random", "array", sizeof(u64), setup_keys, run_sort_u64},
+};
+
+static usz item_sizes[] = {4, 16, BENCH_MAX_ITEM};
+
+/**
+ * @struct bench_result
+ * @brief The totals of one measurement.
+ */
+struct bench_result {
+  mut_usz reps;         /**< The number of repetitions. */
+  mut_u64 ns;           /**< Time spent in the measured operation. */
+  mut_usz bytes;        /**< Bytes allocated by the operation. */
+  mut_usz allocations;  /**< Allocations made by the operation. */
+  mut_u64 cache_misses; /**< Cache misses during the operation. */
+};
+
+static struct bench_result measure(struct bench_case const *bench,
+                                   struct bench_ctx *ctx, usz ops) {
+  struct bench_result result = {0};
+  result.reps = ops / ctx->length;
+  if (result.reps < BENCH_MIN_REPS) {
+    result.reps = BENCH_MIN_REPS;
+  }
+
+  for (mut_usz rep = 0; rep < result.reps; ++rep) {
+    bench->setup(ctx);
+    counts = (struct bench_counts){0};
+    perf_start();
+    u64 start = now_ns();
+    bench->run(ctx);
+    result.ns += now_ns() - start;
+    result.cache_misses += perf_stop();
+    result.bytes += counts.bytes;
+    result.allocations += counts.count;
+    teardown(ctx);
+  }
+
+  return result;
+}
+
+static void usage(char const *program) {
+  fprintf(stderr,
+          "usage: %s [--max-length N] [--ops N] [--filter TEXT] [--out FILE]"
+          "\n",
+          program);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  mut_usz max_length = 1000000;
+  mut_usz ops = 2000000;
+  char const *filter = NULL;
+  char const *out_path = NULL;
+
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+    }
+    if (strcmp(argv[i], "--max-length") == 0) {
+      max_length = (usz)strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--ops") == 0) {
+      ops = (usz)strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--filter") == 0) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--out") == 0) {
+      out_path = argv[++i];
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  FILE *out = out_path ? fopen(out_path, "w") : stdout;
+  if (out == NULL) {
+    perror(out_path);
+    return 1;
+  }
+
+  perf_open();
+  fprintf(out,
+          "{\n  \"library\": \"vec\",\n  \"max_length\": %zu,\n"
+          "  \"ops\": %zu,\n  \"cache_misses\": %s,\n  \"results\": [",
+          (size_t)max_length, (size_t)ops, perf_fd >= 0 ? "true" : "false");
+  fprintf(stderr, "%-20s %-10s %-8s %5s %10s %10s %10s %10s\n", "case",
+          "pattern", "mode", "size", "length", "ns/op", "bytes/op",
+          "misses/op");
+
+  struct bench_ctx ctx = {.rng = BENCH_SEED};
+  mut_usz emitted = 0;
+  for (mut_usz c = 0; c < sizeof cases / sizeof *cases; ++c) {
+    struct bench_case const *bench = &cases[c];
+    if (filter != NULL && strstr(bench->name, filter) == NULL) {
+      continue;
+    }
+
+    for (mut_usz s = 0; s < sizeof item_sizes / sizeof *item_sizes; ++s) {
+      if (bench->fixed_size != 0 && s > 0) {
+        break;
+      }
+
+      for (mut_usz length = 10; length <= max_length; length *= 10) {
+        ctx.length = length;
+        ctx.item_size = bench->fixed_size ? bench->fixed_size : item_sizes[s];
+        ctx.flat = strcmp(bench->mode, "pointer") != 0;
+        ctx.rng = BENCH_SEED;
+
+        struct bench_result result = measure(bench, &ctx, ops);
+        f64 per_op = (f64)(result.reps * length);
+        f64 ns = (f64)result.ns / per_op;
+        f64 bytes = (f64)result.bytes / per_op;
+        f64 allocations = (f64)result.allocations / per_op;
+        f64 misses = (f64)result.cache_misses / per_op;
+
+        fprintf(out,
+                "%s\n    {\"name\": \"%s\", \"pattern\": \"%s\", "
+                "\"mode\": \"%s\", \"item_size\": %zu, \"length\": %zu, "
+                "\"reps\": %zu, \"ns_per_op\": %.3f, "
+                "\"bytes_per_op\": %.3f, \"allocations_per_op\": %.6f, "
+                "\"bytes_allocated\": %zu, \"allocations\": %zu, "
+                "\"cache_misses_per_op\": ",
+                emitted++ ? "," : "", bench->name, bench->pattern,
+                bench->mode, (size_t)ctx.item_size, (size_t)length,
+                (size_t)result.reps, ns, bytes, allocations,
+                (size_t)(result.bytes / result.reps),
+                (size_t)(result.allocations / result.reps));
+        if (perf_fd >= 0) {
+          fprintf(out, "%.4f}", misses);
+        } else {
+          fprintf(out, "null}");
+        }
+        fprintf(stderr, "%-20s %-10s %-8s %5zu %10zu %10.2f %10.2f ",
+                bench->name, bench->pattern, bench->mode,
+                (size_t)ctx.item_size, (size_t)length, ns, bytes);
+        if (perf_fd >= 0) {
+          fprintf(stderr, "%10.4f\n", misses);
+        } else {
+          fprintf(stderr, "%10s\n", "-");
+        }
+        fflush(out);
+      }
+    }
+  }
+
+  fprintf(out, "\n  ],\n  \"checksum\": %llu\n}\n",
+          (unsigned long long)ctx.sink);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
@@ -0,0 +1,36 @@
+#include "vec_typed.h"
+#include "wtfc.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+VEC_DEFINE(i32)
+
+void double_i32(mut_i32 *item) { *item *= 2; }
+
+int main(void) {
+  vec_i32 numbers = vec_i32_init();
+  for (mut_i32 i = 1; i <= 10; ++i) {
+    vec_i32_push(&numbers, i);
+  }
+
+  vec_i32_foreach(&numbers, double_i32);
+
+  mut_i64 sum = 0;
+  VEC_FOREACH(mut_i32, &numbers, item) { sum += *item; }
+
+  printf("vec_i32 length: %zu\n", vec_i32_length(&numbers));
+  printf("vec_i32 data: ");
+  VEC_FOREACH(mut_i32, &numbers, item) { printf("%" PRIi32 " ", *item); }
+  puts("");
+  printf("vec_i32 sum: %" PRIi64 "\n", sum);
+
+  mut_i32 *a = svec_init(mut_i32);
+  svec_append_array(a, numbers.data, vec_i32_length(&numbers));
+  svec_get(a, 0) = 1000;
+  printf("svec data: a[0] = %" PRIi32 ", a[9] = %" PRIi32 "\n",
+         svec_get(a, 0), svec_get(a, 9));
+
+  free(a);
+  vec_i32_destroy(&numbers);
+  return EXIT_SUCCESS;
+}
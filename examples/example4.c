@@ -0,0 +1,49 @@
+#include "vec.h"
+#include "wtfc.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void print_i32(vec_item item) {
+  mut_i32 *v = item;
+
+  printf("%" PRIi32 " ", *v);
+}
+
+void inc_i32(vec_item item) {
+  mut_i32 *v = item;
+
+  *v += 100;
+}
+
+vec_interface vec_i32_interface = {.item_size = sizeof(mut_i32),
+                                   .flat = true};
+
+int main(void) {
+  mut_vec numbers = vec_init(vec_i32_interface);
+  for (mut_i32 i = 0; i < 64; ++i) {
+    vec_push(numbers, &i);
+  }
+
+  // a write through a view reaches the viewed vector only
+  mut_vec copy = vec_copy(numbers);
+  vec_storage storage;
+  vec view = vec_view(&storage, numbers, 0, 4);
+  vec_foreach(view, inc_i32);
+
+  puts("Writes through a view:");
+  vec_println(view, print_i32);
+  vec_println(vec_view(&(vec_storage){0}, copy, 0, 4), print_i32);
+  vec_destroy(copy);
+
+  // a write to the viewed vector stays visible through the view, even
+  // when a copy is made and destroyed in between
+  copy = vec_copy(numbers);
+  vec_foreach(numbers, inc_i32);
+  vec_destroy(copy);
+
+  puts("Writes to the viewed vector:");
+  vec_println(view, print_i32);
+
+  vec_destroy(numbers);
+  return EXIT_SUCCESS;
+}
@@ -1,29 +1,148 @@
 #include "vec.h"
+#include "vec_impl.h"
+#include "vec_typed.h"
 #include "wtfc.h"
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define VEC_INITIAL_ALLOC_SIZE 8
+void *_vec_allocate(vec_allocator *allocator, usz size) {
+  void *ptr = allocator ? allocator->allocate(allocator->ctx, size)
+                        : malloc(size);
+  if (ptr == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  return ptr;
+}
 
-#define OUT_OF_MEMORY                                                          \
-  do {                                                                         \
-    fprintf(stderr, "%s:%d - out of memory\n", __FILE__, __LINE__);            \
-    exit(1);                                                                   \
-  } while (0)
+void *_vec_reallocate(vec_allocator *allocator, void *ptr, usz old_size,
+                      usz new_size) {
+  void *new_ptr = allocator ? allocator->reallocate(allocator->ctx, ptr,
+                                                    old_size, new_size)
+                            : realloc(ptr, new_size);
+  if (new_ptr == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  return new_ptr;
+}
+
+void _vec_release(vec_allocator *allocator, void *ptr, usz size) {
+  if (allocator) {
+    allocator->release(allocator->ctx, ptr, size);
+  } else {
+    free(ptr);
+  }
+}
 
 /**
- * @struct vec
- * @brief A dynamic array implementation.
+ * @union _vec_shared
+ * @brief Header in front of every heap element buffer.
+ *
+ * Copies of a vector share its buffer until one of them is modified.
  */
-struct vec {
-  struct vec_interface
-      interface;   /**< Interface for working with vector elements */
-  mut_usz length;  /**< The current length of the vector. */
-  mut_usz alloc;   /**< The current allocated size of the vector. */
-  void **elements; /**< The array of elements. */
+union _vec_shared {
+  atomic_size_t refs; /**< The number of vectors using the buffer. */
+  max_align_t align;  /**< Keeps the items behind the header aligned. */
 };
 
+/**
+ * @brief Allocates a heap element buffer owned by a single vector.
+ *
+ * @param allocator The allocator, NULL for malloc.
+ * @param size The size of the items of the buffer.
+ * @return The address of the items of the buffer.
+ */
+static void *_buffer_allocate(vec_allocator *allocator, usz size) {
+  union _vec_shared *shared = _vec_allocate(allocator, sizeof *shared + size);
+  atomic_init(&shared->refs, 1);
+  return shared + 1;
+}
+
+/**
+ * @brief Resizes a heap element buffer owned by a single vector.
+ *
+ * @param allocator The allocator, NULL for realloc.
+ * @param elements The address of the items of the buffer.
+ * @param old_size The current size of the items of the buffer.
+ * @param new_size The requested size of the items of the buffer.
+ * @return The address of the items of the resized buffer.
+ */
+static void *_buffer_reallocate(vec_allocator *allocator, void *elements,
+                                usz old_size, usz new_size) {
+  union _vec_shared *shared = (union _vec_shared *)elements - 1;
+  shared = _vec_reallocate(allocator, shared, sizeof *shared + old_size,
+                       sizeof *shared + new_size);
+  return shared + 1;
+}
+
+/**
+ * @brief Frees a heap element buffer.
+ *
+ * @param allocator The allocator, NULL for free.
+ * @param elements The address of the items of the buffer.
+ * @param size The size of the items of the buffer.
+ */
+static void _buffer_release(vec_allocator *allocator, void *elements,
+                            usz size) {
+  union _vec_shared *shared = (union _vec_shared *)elements - 1;
+  _vec_release(allocator, shared, sizeof *shared + size);
+}
+
+/**
+ * @brief Checks if the items of the vector live in its small buffer.
+ *
+ * @param self The vector.
+ * @return Returns true if the items are stored inline, false otherwise.
+ */
+static bool _is_inline(vec self) {
+  return self->elements == (void const *)self->inline_items;
+}
+
+/**
+ * @brief Initializes an empty vector in place.
+ *
+ * The small buffer is used when it fits `alloc` items, the heap otherwise.
+ *
+ * @param self The memory of the vector.
+ * @param interface The interface for the vector items.
+ * @param alloc The number of items to make room for.
+ * @param owned Whether vec_destroy should free the header.
+ */
+static void _init_at(mut_vec self, vec_interface interface, usz alloc,
+                     bool owned) {
+  usz slot_size = interface.flat ? interface.item_size : sizeof(vec_item);
+  usz inline_alloc = slot_size ? VEC_INLINE_SIZE / slot_size : 0;
+
+  *self = (struct vec){
+      .length = 0, .stride = 1, .owned = owned, .interface = interface};
+
+  if (alloc <= inline_alloc) {
+    self->elements = self->inline_items;
+    self->alloc = inline_alloc;
+  } else {
+    self->elements = _buffer_allocate(interface.allocator, slot_size * alloc);
+    self->alloc = alloc;
+  }
+
+  VEC_STAT(_vec_stats_track(self));
+}
+
+/**
+ * @brief Allocates an empty vector with room for a given number of items.
+ *
+ * @param interface The interface for the vector items.
+ * @param alloc The number of items to allocate room for.
+ * @return Returns a new vector.
+ */
+static mut_vec _init_alloc(vec_interface interface, usz alloc) {
+  mut_vec vector = _vec_allocate(interface.allocator, sizeof *vector);
+  _init_at(vector, interface, alloc, true);
+  return vector;
+}
+
 /**
  * @brief Checks if there is space available in the vector.
  *
@@ -33,47 +152,267 @@ struct vec {
 static bool _is_space(vec self) { return self->alloc != self->length; }
 
 /**
- * @brief Resizes the vector if necessary.
+ * @brief Computes the capacity to grow a buffer to.
  *
- * @param self The vector.
- * @return Returns true if the resize was successful, false otherwise.
+ * @param growth The growth policy.
+ * @param alloc The current capacity.
+ * @param needed The minimal capacity required.
+ * @param slot_size The size of one item of the buffer.
+ * @return The new capacity, at least `needed`.
  */
-static void _resize(mut_vec self) {
-  usz new_size = sizeof *self->elements * self->alloc * (self->length / 2);
-  void **new_elements = realloc(self->elements, new_size);
-  if (new_elements == NULL) {
+static mut_usz _next_capacity(enum vec_growth growth, usz alloc, usz needed,
+                              usz slot_size) {
+  mut_usz capacity = alloc > VEC_INITIAL_ALLOC_SIZE ? alloc
+                                                    : VEC_INITIAL_ALLOC_SIZE;
+  while (capacity < needed) {
+    if (capacity > USZ_MAX / 2) {
+      OUT_OF_MEMORY;
+    }
+    capacity += growth == VEC_GROW_HALF ? capacity / 2 : capacity;
+  }
+
+  if (slot_size && capacity > USZ_MAX / slot_size) {
     OUT_OF_MEMORY;
   }
 
-  self->alloc *= self->length / 2;
-  self->elements = new_elements;
+  if (growth == VEC_GROW_PAGE && slot_size) {
+    usz bytes = (capacity * slot_size + VEC_PAGE_SIZE - 1) &
+                ~((usz)VEC_PAGE_SIZE - 1);
+    capacity = bytes / slot_size;
+  }
+
+  return capacity;
+}
+
+/**
+ * @brief Moves the items of the vector into a buffer of another capacity.
+ *
+ * Uses the small buffer whenever the capacity fits into it.
+ *
+ * @param self The vector.
+ * @param capacity The new capacity, not less than the length.
+ */
+static void _set_capacity(mut_vec self, usz capacity) {
+  usz slot_size = _slot_size(self);
+  usz inline_alloc = slot_size ? VEC_INLINE_SIZE / slot_size : 0;
+
+  if (capacity <= inline_alloc) {
+    if (!_is_inline(self)) {
+      VEC_STAT(_vec_stats_resize(self, slot_size * self->length,
+                                 slot_size * inline_alloc));
+      memcpy(self->inline_items, self->elements, slot_size * self->length);
+      _buffer_release(self->interface.allocator, self->elements,
+                      slot_size * self->alloc);
+      self->elements = self->inline_items;
+    }
+    self->alloc = inline_alloc;
+    return;
+  }
+
+  VEC_STAT(_vec_stats_resize(self, slot_size * self->length,
+                             slot_size * capacity));
+  if (_is_inline(self)) {
+    void *elements =
+        _buffer_allocate(self->interface.allocator, slot_size * capacity);
+    memcpy(elements, self->elements, slot_size * self->length);
+    self->elements = elements;
+  } else {
+    self->elements =
+        _buffer_reallocate(self->interface.allocator, self->elements,
+                           slot_size * self->alloc, slot_size * capacity);
+  }
+
+  self->alloc = capacity;
+}
+
+/**
+ * @brief Grows the vector following its growth policy.
+ *
+ * @param self The vector.
+ * @param needed The minimal capacity required.
+ */
+static void _grow(mut_vec self, usz needed) {
+  _set_capacity(self, _next_capacity(self->interface.growth, self->alloc,
+                                     needed, _slot_size(self)));
+}
+
+/**
+ * @brief Checks if the vector shares its buffer with copies.
+ *
+ * @param self The vector.
+ * @return Returns true if the buffer is shared, false otherwise.
+ */
+static bool _is_shared(vec self) {
+  return !_is_inline(self) &&
+         atomic_load_explicit(&((union _vec_shared *)self->elements - 1)->refs,
+                              memory_order_acquire) > 1;
+}
+
+vec_item _vec_clone_item(vec self, vec_item item) {
+  VEC_STAT(_vec_stats_item_copy(self));
+  vec_item copy =
+      _vec_allocate(self->interface.allocator, self->interface.item_size);
+  memcpy(copy, item, self->interface.item_size);
+  return copy;
+}
+
+void _vec_unshare(mut_vec self) {
+  if (!_is_shared(self)) {
+    return;
+  }
+
+  VEC_STAT(_vec_stats_unshare(self));
+  usz slot_size = _slot_size(self);
+  vec_item *elements =
+      _buffer_allocate(self->interface.allocator, slot_size * self->alloc);
+
+  if (self->interface.flat) {
+    memcpy(elements, self->elements, slot_size * self->length);
+  } else {
+    for (mut_usz i = 0; i < self->length; ++i) {
+      elements[i] = _vec_clone_item(self, _at(self, i));
+    }
+  }
+
+  // the other holders may have let go while copying: the last one keeps
+  // the old buffer and drops the copy
+  atomic_size_t *refs = &((union _vec_shared *)self->elements - 1)->refs;
+  if (atomic_fetch_sub_explicit(refs, 1, memory_order_acq_rel) == 1) {
+    atomic_store_explicit(refs, 1, memory_order_relaxed);
+    if (!self->interface.flat) {
+      for (mut_usz i = 0; i < self->length; ++i) {
+        _vec_release(self->interface.allocator, elements[i],
+                     self->interface.item_size);
+      }
+    }
+    _buffer_release(self->interface.allocator, elements,
+                    slot_size * self->alloc);
+    return;
+  }
+
+  self->elements = elements;
+}
+
+mut_vec _vec_copy_range(vec self, usz first_index, usz second_index) {
+  VEC_STAT(_vec_stats_copy(self));
+  usz count = second_index - first_index;
+  mut_vec slice = _init_alloc(self->interface, count);
+
+  if (self->interface.flat && self->stride == 1) {
+    if (count) {
+      memcpy(slice->elements, _slot(self, first_index),
+             count * self->interface.item_size);
+    }
+    slice->length = count;
+    return slice;
+  }
+
+  if (self->interface.flat) {
+    for (mut_usz i = first_index; i < second_index; ++i) {
+      vec_push(slice, _at(self, i));
+    }
+    return slice;
+  }
+
+  for (mut_usz i = first_index; i < second_index; ++i) {
+    vec_push(slice, _vec_clone_item(self, _at(self, i)));
+  }
+
+  return slice;
 }
 
 // allocation functions
 mut_vec vec_init(vec_interface interface) {
-  void **elements = malloc(sizeof *elements * VEC_INITIAL_ALLOC_SIZE);
-  if (elements == NULL) {
-    OUT_OF_MEMORY;
+  return _init_alloc(interface, 0);
+}
+
+mut_vec vec_with_capacity(vec_interface interface, usz capacity) {
+  return _init_alloc(interface, capacity);
+}
+
+mut_vec vec_init_in(vec_storage *storage, vec_interface interface) {
+  mut_vec vector = (void *)storage;
+  _init_at(vector, interface, 0, false);
+  return vector;
+}
+
+/**
+ * @brief Applies a function to each item without unsharing the buffer.
+ *
+ * @param self The vector.
+ * @param apply The function, which must not modify the items.
+ */
+static void _foreach(vec self, void (*apply)(vec_item item)) {
+  if (apply == NULL) {
+    return;
   }
 
-  mut_vec vector = malloc(sizeof *vector);
-  if (vector == NULL) {
-    OUT_OF_MEMORY;
+  usz len = self->length;
+  usz stride = self->stride;
+  if (self->interface.flat) {
+    char *item = self->elements;
+    usz step = self->interface.item_size * stride;
+    for (mut_usz i = 0; i < len; ++i, item += step) {
+      apply(item);
+    }
+  } else {
+    vec_item *elements = self->elements;
+    for (mut_usz i = 0; i < len; ++i) {
+      apply(elements[i * stride]);
+    }
   }
+}
 
-  *vector = (struct vec){.elements = elements,
-                         .alloc = VEC_INITIAL_ALLOC_SIZE,
-                         .length = 0,
-                         .interface = interface};
+/**
+ * @brief Applies a function taking a context to each item without
+ * unsharing the buffer.
+ *
+ * @param self The vector.
+ * @param apply The function, which must not modify the items.
+ * @param ctx The context passed to `apply`.
+ */
+static void _foreach_ctx(vec self, void (*apply)(void *ctx, vec_item item),
+                         void *ctx) {
+  if (apply == NULL) {
+    return;
+  }
 
-  return vector;
+  usz len = self->length;
+  usz stride = self->stride;
+  if (self->interface.flat) {
+    char *item = self->elements;
+    usz step = self->interface.item_size * stride;
+    for (mut_usz i = 0; i < len; ++i, item += step) {
+      apply(ctx, item);
+    }
+  } else {
+    vec_item *elements = self->elements;
+    for (mut_usz i = 0; i < len; ++i) {
+      apply(ctx, elements[i * stride]);
+    }
+  }
 }
 
 void vec_destroy(void *self) {
   mut_vec v = self;
-  vec_foreach(v, v->interface.destroy);
-  free(v->elements);
-  free(v);
+  if (v->borrowed) {
+    return;
+  }
+
+  if (_is_inline(v)) {
+    _foreach(v, v->interface.destroy);
+  } else if (atomic_fetch_sub_explicit(
+                 &((union _vec_shared *)v->elements - 1)->refs, 1,
+                 memory_order_acq_rel) == 1) {
+    _foreach(v, v->interface.destroy);
+    _buffer_release(v->interface.allocator, v->elements,
+                    _slot_size(v) * v->alloc);
+  }
+
+  VEC_STAT(_vec_stats_untrack(v));
+  if (v->owned) {
+    _vec_release(v->interface.allocator, v, sizeof *v);
+  }
 }
 
 mut_vec vec_slice(vec self, usz first_index, usz second_index) {
@@ -82,74 +421,194 @@ mut_vec vec_slice(vec self, usz first_index, usz second_index) {
     return NULL;
   }
 
-  mut_vec slice = vec_init(self->interface);
-  for (mut_usz i = first_index; i < second_index; ++i) {
-    vec_item new_item = malloc(self->interface.item_size);
-    if (new_item) {
-      memcpy(new_item, self->elements[i], self->interface.item_size);
-      vec_push(slice, new_item);
-    } else {
-      OUT_OF_MEMORY;
-    }
+  return _vec_copy_range(self, first_index, second_index);
+}
+
+mut_vec vec_copy(vec self) {
+  // sharing the buffer of a viewed vector would move it on its next write
+  if (self->borrowed || self->viewed || _is_inline(self)) {
+    return _vec_copy_range(self, 0, self->length);
   }
 
-  return slice;
+  atomic_fetch_add_explicit(&((union _vec_shared *)self->elements - 1)->refs,
+                            1, memory_order_relaxed);
+
+  mut_vec copy = _vec_allocate(self->interface.allocator, sizeof *copy);
+  *copy = (struct vec){.interface = self->interface,
+                       .length = self->length,
+                       .alloc = self->alloc,
+                       .elements = self->elements,
+                       .stride = 1,
+                       .owned = true,
+                       .borrowed = false};
+  VEC_STAT(_vec_stats_copy(self));
+  VEC_STAT(_vec_stats_track(copy));
+  return copy;
+}
+
+vec vec_view(vec_storage *storage, vec self, usz first_index,
+             usz second_index) {
+  return vec_view_strided(storage, self, first_index, second_index, 1);
 }
 
-mut_vec vec_copy(vec self) { return vec_slice(self, 0, self->length); }
+vec vec_view_strided(vec_storage *storage, vec self, usz first_index,
+                     usz second_index, usz step) {
+  if (first_index >= self->length || second_index > self->length ||
+      first_index >= second_index || step == 0) {
+    return NULL;
+  }
+
+  // the view must see the buffer the vector keeps writing to
+  if (!self->borrowed) {
+    mut_vec source = (mut_vec)(uptr)self;
+    _vec_unshare(source);
+    source->viewed = true;
+  }
+
+  mut_vec view = (void *)storage;
+  usz count = (second_index - first_index + step - 1) / step;
+  *view = (struct vec){.interface = self->interface,
+                       .length = count,
+                       .alloc = count,
+                       .elements = _slot(self, first_index),
+                       .stride = self->stride * step,
+                       .owned = false,
+                       .borrowed = true};
+
+  return view;
+}
 
 vec vec_map(vec self, void (*apply)(vec_item item)) {
-  mut_vec new_vec = vec_copy(self);
+  mut_vec new_vec = _vec_copy_range(self, 0, self->length);
   vec_foreach(new_vec, apply);
   return new_vec;
 }
 
 vec vec_map2(vec self, vec other,
              void (*apply)(vec_item item_a, vec_item item_b)) {
-  mut_vec new_vec = vec_copy(self);
+  mut_vec new_vec = _vec_copy_range(self, 0, self->length);
   vec_foreach2(new_vec, other, apply);
   return new_vec;
 }
 
+vec vec_map_ctx(vec self, void (*apply)(void *ctx, vec_item item),
+                void *ctx) {
+  mut_vec new_vec = _vec_copy_range(self, 0, self->length);
+  vec_foreach_ctx(new_vec, apply, ctx);
+  return new_vec;
+}
+
 // information functions
 bool vec_empty(vec self) { return self->length == 0; }
 
 mut_usz vec_length(vec self) { return self->length; }
 
+mut_usz vec_capacity(vec self) { return self->alloc; }
+
 void vec_print(vec self, void (*print)(vec_item item)) {
-  vec_foreach(self, print);
+  _foreach(self, print);
 }
 
 void vec_println(vec self, void (*print)(vec_item item)) {
-  vec_foreach(self, print);
+  _foreach(self, print);
+  puts("");
+}
+
+void vec_print_ctx(vec self, void (*print)(void *ctx, vec_item item),
+                   void *ctx) {
+  _foreach_ctx(self, print, ctx);
+}
+
+void vec_println_ctx(vec self, void (*print)(void *ctx, vec_item item),
+                     void *ctx) {
+  _foreach_ctx(self, print, ctx);
   puts("");
 }
 
 // modification functions
 void vec_foreach(vec self, void (*apply)(vec_item item)) {
+  if (apply != NULL) {
+    _vec_unshare_items(self);
+    _foreach(self, apply);
+  }
+}
+
+void vec_foreach2(vec self, vec other,
+                  void (*apply)(vec_item item_a, vec_item item_b)) {
   if (apply) {
+    _vec_unshare_items(self);
     usz len = self->length;
     for (mut_usz i = 0; i < len; ++i) {
-      apply(self->elements[i]);
+      apply(_at(self, i), _at(other, i));
     }
   }
 }
 
-void vec_foreach2(vec self, vec other,
-                  void (*apply)(vec_item item_a, vec_item item_b)) {
+void vec_foreach_ctx(vec self, void (*apply)(void *ctx, vec_item item),
+                     void *ctx) {
+  if (apply != NULL) {
+    _vec_unshare_items(self);
+    _foreach_ctx(self, apply, ctx);
+  }
+}
+
+void vec_foreach2_ctx(vec self, vec other,
+                      void (*apply)(void *ctx, vec_item item_a,
+                                    vec_item item_b),
+                      void *ctx) {
   if (apply) {
+    _vec_unshare_items(self);
     usz len = self->length;
     for (mut_usz i = 0; i < len; ++i) {
-      apply(self->elements[i], other->elements[i]);
+      apply(ctx, _at(self, i), _at(other, i));
+    }
+  }
+}
+
+void vec_foreach_batch(vec self,
+                       void (*apply)(void *ctx, vec_item *items, usz count),
+                       void *ctx) {
+  if (apply == NULL || self->length == 0) {
+    return;
+  }
+
+  _vec_unshare_items(self);
+  if (!self->interface.flat && self->stride == 1) {
+    apply(ctx, self->elements, self->length);
+    return;
+  }
+
+  vec_item batch[VEC_BATCH_SIZE];
+  for (mut_usz first = 0; first < self->length; first += VEC_BATCH_SIZE) {
+    usz count = self->length - first < VEC_BATCH_SIZE ? self->length - first
+                                                      : VEC_BATCH_SIZE;
+    for (mut_usz i = 0; i < count; ++i) {
+      batch[i] = _at(self, first + i);
     }
+    apply(ctx, batch, count);
+  }
+}
+
+void vec_reserve(mut_vec self, usz capacity) {
+  _vec_unshare(self);
+  if (capacity > self->alloc) {
+    _set_capacity(self, capacity);
   }
 }
 
+void vec_shrink_to_fit(mut_vec self) {
+  _vec_unshare(self);
+  _set_capacity(self, self->length);
+}
+
 bool vec_pop(mut_vec self) {
   if (vec_empty(self))
     return false;
 
-  self->interface.destroy(self->elements[self->length - 1]);
+  _vec_unshare(self);
+  if (self->interface.destroy) {
+    self->interface.destroy(_at(self, self->length - 1));
+  }
   --self->length;
   return true;
 }
@@ -159,8 +618,11 @@ bool vec_set(mut_vec self, usz index, vec_item item) {
     return false;
   }
 
-  self->interface.destroy(self->elements[index]);
-  self->elements[index] = item;
+  _vec_unshare(self);
+  if (self->interface.destroy) {
+    self->interface.destroy(_at(self, index));
+  }
+  _store(self, index, item);
   return true;
 }
 
@@ -169,53 +631,360 @@ bool vec_modify(mut_vec self, usz index, void (*apply)(vec_item item)) {
     return false;
   }
 
-  apply(self->elements[index]);
+  _vec_unshare(self);
+  apply(_at(self, index));
+  return true;
+}
+
+bool vec_modify_ctx(mut_vec self, usz index,
+                    void (*apply)(void *ctx, vec_item item), void *ctx) {
+  if (index >= self->length) {
+    return false;
+  }
+
+  _vec_unshare(self);
+  apply(ctx, _at(self, index));
   return true;
 }
 
 void vec_push(mut_vec self, vec_item item) {
-  if (_is_space(self)) {
-    self->elements[self->length] = item;
-    ++self->length;
-  } else {
-    _resize(self);
-    self->elements[self->length] = item;
-    ++self->length;
+  _vec_unshare(self);
+  if (!_is_space(self)) {
+    _grow(self, self->length + 1);
   }
+
+  _store(self, self->length, item);
+  ++self->length;
+  VEC_STAT(_vec_stats_push(self, 1));
 }
 
-void *_svec_init(usz size) {
-  struct _svec_mdi *data = malloc(size * VEC_INITIAL_ALLOC_SIZE + sizeof *data);
-  if (data == NULL) {
+void vec_extend(mut_vec self, void const *items, usz count) {
+  _vec_unshare(self);
+  if (count == 0) {
+    return;
+  }
+
+  if (count > USZ_MAX - self->length) {
     OUT_OF_MEMORY;
   }
 
+  if (self->alloc - self->length < count) {
+    _grow(self, self->length + count);
+  }
+
+  memcpy(_slot(self, self->length), items, _slot_size(self) * count);
+  self->length += count;
+  VEC_STAT(_vec_stats_push(self, count));
+}
+
+bool vec_insert_range(mut_vec self, usz index, void const *items, usz count) {
+  _vec_unshare(self);
+  if (index > self->length) {
+    return false;
+  }
+
+  if (count > USZ_MAX - self->length) {
+    OUT_OF_MEMORY;
+  }
+
+  if (self->alloc - self->length < count) {
+    _grow(self, self->length + count);
+  }
+
+  memmove(_slot(self, index + count), _slot(self, index),
+          _slot_size(self) * (self->length - index));
+  memcpy(_slot(self, index), items, _slot_size(self) * count);
+  self->length += count;
+  VEC_STAT(_vec_stats_push(self, count));
+  return true;
+}
+
+bool vec_insert_at(mut_vec self, usz index, vec_item item) {
+  if (index > self->length || !item) {
+    return false;
+  }
+
+  _vec_unshare(self);
+  if (!_is_space(self)) {
+    _grow(self, self->length + 1);
+  }
+
+  memmove(_slot(self, index + 1), _slot(self, index),
+          _slot_size(self) * (self->length - index));
+  _store(self, index, item);
+  ++self->length;
+  VEC_STAT(_vec_stats_push(self, 1));
+  return true;
+}
+
+bool vec_remove_at(mut_vec self, usz index) {
+  return index < self->length && vec_remove_range(self, index, index + 1);
+}
+
+bool vec_remove_range(mut_vec self, usz first_index, usz second_index) {
+  if (first_index > second_index || second_index > self->length) {
+    return false;
+  }
+
+  _vec_unshare(self);
+  if (self->interface.destroy) {
+    for (mut_usz i = first_index; i < second_index; ++i) {
+      self->interface.destroy(_at(self, i));
+    }
+  }
+
+  memmove(_slot(self, first_index), _slot(self, second_index),
+          _slot_size(self) * (self->length - second_index));
+  self->length -= second_index - first_index;
+  return true;
+}
+
+// reduction and filtering functions
+void vec_reduce(vec self, void (*combine)(void *acc, vec_item item),
+                void *acc) {
+  _foreach_ctx(self, combine, acc);
+}
+
+bool vec_any(vec self, bool (*pred)(void *ctx, vec_item item), void *ctx) {
+  for (mut_usz i = 0; i < self->length; ++i) {
+    if (pred(ctx, _at(self, i))) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool vec_all(vec self, bool (*pred)(void *ctx, vec_item item), void *ctx) {
+  for (mut_usz i = 0; i < self->length; ++i) {
+    if (!pred(ctx, _at(self, i))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+mut_usz vec_count_if(vec self, bool (*pred)(void *ctx, vec_item item),
+                     void *ctx) {
+  mut_usz count = 0;
+  for (mut_usz i = 0; i < self->length; ++i) {
+    count += pred(ctx, _at(self, i)) ? 1 : 0;
+  }
+
+  return count;
+}
+
+mut_vec vec_filter(vec self, bool (*pred)(void *ctx, vec_item item),
+                   void *ctx) {
+  return vec_map_filter(self, NULL, pred, ctx);
+}
+
+mut_vec vec_map_filter(vec self, void (*apply)(void *ctx, vec_item item),
+                       bool (*pred)(void *ctx, vec_item item), void *ctx) {
+  mut_vec result = _init_alloc(self->interface, 0);
+  usz item_size = self->interface.item_size;
+
+  for (mut_usz i = 0; i < self->length; ++i) {
+    vec_item item = _at(self, i);
+    if (apply == NULL && !pred(ctx, item)) {
+      continue;
+    }
+
+    if (!_is_space(result)) {
+      _grow(result, result->length + 1);
+    }
+
+    vec_item copy = self->interface.flat
+                        ? _slot(result, result->length)
+                        : _vec_allocate(self->interface.allocator, item_size);
+    memcpy(copy, item, item_size);
+
+    if (apply) {
+      apply(ctx, copy);
+      if (!pred(ctx, copy)) {
+        if (self->interface.destroy) {
+          self->interface.destroy(copy);
+        } else if (!self->interface.flat) {
+          _vec_release(self->interface.allocator, copy, item_size);
+        }
+        continue;
+      }
+    }
+
+    if (!self->interface.flat) {
+      _store(result, result->length, copy);
+    }
+    result->length += 1;
+  }
+
+  return result;
+}
+
+void vec_retain(mut_vec self, bool (*pred)(void *ctx, vec_item item),
+                void *ctx) {
+  _vec_unshare(self);
+
+  mut_usz kept = 0;
+  usz slot_size = _slot_size(self);
+  for (mut_usz i = 0; i < self->length; ++i) {
+    vec_item item = _at(self, i);
+    if (pred(ctx, item)) {
+      if (kept != i) {
+        memcpy(_slot(self, kept), _slot(self, i), slot_size);
+      }
+      ++kept;
+    } else if (self->interface.destroy) {
+      self->interface.destroy(item);
+    }
+  }
+
+  self->length = kept;
+}
+
+mut_usz vec_partition(mut_vec self, bool (*pred)(void *ctx, vec_item item),
+                      void *ctx) {
+  _vec_unshare(self);
+
+  mut_usz first = 0;
+  mut_usz last = self->length;
+  usz slot_size = _slot_size(self);
+  for (;;) {
+    while (first < last && pred(ctx, _at(self, first))) {
+      ++first;
+    }
+    while (first < last && !pred(ctx, _at(self, last - 1))) {
+      --last;
+    }
+    if (first >= last) {
+      return first;
+    }
+
+    _swap_bytes(_slot(self, first), _slot(self, last - 1), slot_size);
+    ++first;
+    --last;
+  }
+}
+
+void *_vec_typed_grow(void *data, mut_usz *alloc, usz needed, usz item_size) {
+  usz capacity = _next_capacity(VEC_GROW_DOUBLE, *alloc, needed, item_size);
+  VEC_STAT(_vec_stats_resize(NULL, *alloc * item_size, capacity * item_size));
+  void *new_data = realloc(data, capacity * item_size);
+  if (new_data == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  *alloc = capacity;
+  return new_data;
+}
+
+void *_svec_block_allocate(void *ctx, usz size) {
+  (void)ctx;
+  return _vec_allocate(NULL, size);
+}
+
+vec_allocator *_svec_derived_allocator(void const *svec_ptr) {
+  vec_allocator *allocator = ((struct _svec_mdi const *)svec_ptr)->allocator;
+  return allocator != NULL && allocator->allocate == _svec_block_allocate
+             ? NULL
+             : allocator;
+}
+
+void *_svec_init(usz size) { return _svec_init_with(size, NULL); }
+
+void *_svec_init_with(usz size, vec_allocator *allocator) {
+  return _svec_with_capacity(size, VEC_INITIAL_ALLOC_SIZE, allocator);
+}
+
+void *_svec_with_capacity(usz size, usz capacity, vec_allocator *allocator) {
+  if (size && capacity > (USZ_MAX - sizeof(struct _svec_mdi)) / size) {
+    OUT_OF_MEMORY;
+  }
+
+  struct _svec_mdi *data =
+      _vec_allocate(allocator, size * capacity + sizeof *data);
+
   data->length = 0;
-  data->alloc = VEC_INITIAL_ALLOC_SIZE;
+  data->alloc = capacity;
   data->type_size = size;
+  data->allocator = allocator;
   return data;
 }
 
-void _svec_push(void *svec_ptr, void *value) {
+void svec_destroy(void *svec_ptr) {
   struct _svec_mdi *data = svec_ptr;
+  if (data == NULL) {
+    return;
+  }
 
-  if ((data->alloc - data->length) > 0) {
-    memcpy((char *)(data + 1) + data->length * data->type_size, value,
-           data->type_size);
-    data->length += 1;
-  } else {
-    void *new_data =
-        realloc(svec_ptr, data->type_size * data->alloc * 2 + sizeof *data);
+  _vec_release(data->allocator, data,
+           data->type_size * data->alloc + sizeof *data);
+}
 
-    if (new_data == NULL) {
-      OUT_OF_MEMORY;
-    }
+/**
+ * @brief Moves an svec into a block of another capacity.
+ *
+ * @param data The svec.
+ * @param capacity The new capacity, not less than the length.
+ * @return The pointer to the svec, which moves when it is reallocated.
+ */
+static struct _svec_mdi *_svec_set_capacity(struct _svec_mdi *data,
+                                            usz capacity) {
+  if (data->type_size &&
+      capacity > (USZ_MAX - sizeof *data) / data->type_size) {
+    OUT_OF_MEMORY;
+  }
 
-    data = new_data;
-    data->alloc *= 2;
-    data->length += 1;
-    svec_ptr = (void *)data;
-    memcpy((char *)(data + 1) + (data->length - 1) * data->type_size, value,
-           data->type_size);
+  VEC_STAT(_vec_stats_resize(NULL, data->type_size * data->length,
+                             data->type_size * capacity));
+  data = _vec_reallocate(data->allocator, data,
+                     data->type_size * data->alloc + sizeof *data,
+                     data->type_size * capacity + sizeof *data);
+  data->alloc = capacity;
+  return data;
+}
+
+void *_svec_reserve(void *svec_ptr, usz capacity) {
+  struct _svec_mdi *data = svec_ptr;
+  return capacity > data->alloc ? _svec_set_capacity(data, capacity) : data;
+}
+
+void *_svec_shrink_to_fit(void *svec_ptr) {
+  struct _svec_mdi *data = svec_ptr;
+  return data->alloc != data->length ? _svec_set_capacity(data, data->length)
+                                     : data;
+}
+
+void *_svec_push(void *svec_ptr, void *value) {
+  struct _svec_mdi *data = svec_ptr;
+
+  if (data->alloc == data->length) {
+    data = _svec_set_capacity(
+        data, _next_capacity(VEC_GROW_DOUBLE, data->alloc, data->length + 1,
+                             data->type_size));
   }
+
+  memcpy((char *)(data + 1) + data->length * data->type_size, value,
+         data->type_size);
+  data->length += 1;
+  VEC_STAT(_vec_stats_push(NULL, 1));
+  return data;
+}
+
+void *_svec_append(void *svec_ptr, void const *array, usz count) {
+  struct _svec_mdi *data = svec_ptr;
+
+  if (data->alloc - data->length < count) {
+    data = _svec_set_capacity(
+        data, _next_capacity(VEC_GROW_DOUBLE, data->alloc,
+                             data->length + count, data->type_size));
+  }
+
+  if (count) {
+    memcpy((char *)(data + 1) + data->length * data->type_size, array,
+           data->type_size * count);
+  }
+  data->length += count;
+  VEC_STAT(_vec_stats_push(NULL, count));
+  return data;
 }
@@ -32,24 +32,90 @@ typedef struct vec *mut_vec;
  */
 typedef struct vec const *vec;
 
+/**
+ * @struct  vec_allocator
+ * @brief Allocator used for the memory of vectors and svecs.
+ *
+ * Every callback receives `ctx` as its first argument. Sizes of existing
+ * blocks are always passed back, so allocators do not have to track them.
+ * Ready-made arena and pool allocators live in vec_alloc.h.
+ */
+typedef struct vec_allocator {
+  void *(*allocate)(void *ctx, usz size); /**< Allocates a block. */
+  void *(*reallocate)(void *ctx, void *ptr, usz old_size,
+                      usz new_size);             /**< Resizes a block. */
+  void (*release)(void *ctx, void *ptr, usz size); /**< Frees a block. */
+  void *ctx; /**< Allocator state passed to every callback. */
+} const vec_allocator;
+
+/**
+ * @enum  vec_growth
+ * @brief Policy used to grow the buffer of a vector when it is full.
+ */
+enum vec_growth {
+  VEC_GROW_DOUBLE, /**< Double the capacity. */
+  VEC_GROW_HALF,   /**< Grow the capacity by half of itself. */
+  VEC_GROW_PAGE,   /**< Double the capacity, rounded up to whole pages. */
+};
+
+/**
+ * @brief Page size used by VEC_GROW_PAGE.
+ */
+#define VEC_PAGE_SIZE 4096
+
 /**
  * @struct  vec_interface
  * @brief Interface for creating a vector
+ *
+ * By default the vector stores pointers to separately allocated items and
+ * owns them: `destroy` is expected to release an item. With `flat` set, items
+ * of `item_size` bytes are stored by value in one contiguous buffer. Pushed
+ * items are copied in, the caller keeps ownership of the source, and
+ * `destroy` (if any) only finalizes an item in place and must not free it.
  */
 typedef struct vec_interface {
   mut_usz item_size; /**< he size of the item. */
   void (*destroy)(
       vec_item item); /**< A function pointer to destroy the item. */
+  bool flat;          /**< Store items by value in a contiguous buffer. */
+  vec_allocator *allocator; /**< Allocator for the vector and item copies,
+                               NULL for malloc. */
+  enum vec_growth growth;   /**< Growth policy, VEC_GROW_DOUBLE by default. */
 } const vec_interface;
 
+/**
+ * @brief Size of the small buffer inside every vector.
+ *
+ * Items that fit into it (8 pointers, or as many flat items as fit) are
+ * stored without touching the heap.
+ */
+#define VEC_INLINE_SIZE 64
+
+/**
+ * @brief Size of the memory needed to hold a vector in place.
+ */
+#define VEC_STORAGE_SIZE 192
+
+/**
+ * @struct  vec_storage
+ * @brief Memory for a vector placed on the stack or inside another struct.
+ */
+typedef struct vec_storage {
+  union {
+    max_align_t align;                   /**< Forces the alignment. */
+    unsigned char bytes[VEC_STORAGE_SIZE]; /**< The memory of the vector. */
+  } data;                                /**< The storage. */
+} vec_storage;
+
 /**
  * @struct  svec_mdi
  * @brief Structure to hold metadata information for a vector.
  */
 struct _svec_mdi {
-  mut_usz length;    /**< Length of the vector. */
-  mut_usz alloc;     /**< Allocated memory for the vector. */
-  mut_usz type_size; /**< Size of each element in the vector. */
+  mut_usz length;           /**< Length of the vector. */
+  mut_usz alloc;            /**< Allocated memory for the vector. */
+  mut_usz type_size;        /**< Size of each element in the vector. */
+  vec_allocator *allocator; /**< Allocator of the block, NULL for malloc. */
 };
 
 // allocation functions
@@ -57,11 +123,36 @@ struct _svec_mdi {
 /**
  * @brief Initializes a new vector.
  *
+ * Only the vector itself is allocated, items are kept in its small buffer
+ * until they outgrow it.
+ *
  * @param interface The interface for the vector items.
  * @return Returns a new vector.
  */
 mut_vec vec_init(vec_interface interface);
 
+/**
+ * @brief Initializes a new vector with room for a number of items.
+ *
+ * @param interface The interface for the vector items.
+ * @param capacity The number of items to make room for.
+ * @return Returns a new vector.
+ */
+mut_vec vec_with_capacity(vec_interface interface, usz capacity);
+
+/**
+ * @brief Initializes a new vector inside caller-provided memory.
+ *
+ * No memory is allocated until the items outgrow the small buffer. The
+ * storage must not be moved while the vector is in use, and vec_destroy
+ * releases the items and the spilled buffer but not the storage itself.
+ *
+ * @param storage The memory to place the vector in.
+ * @param interface The interface for the vector items.
+ * @return Returns the vector, pointing into `storage`.
+ */
+mut_vec vec_init_in(vec_storage *storage, vec_interface interface);
+
 /**
  * @brief Destroys a vector and frees its memory.
  *
@@ -83,11 +174,51 @@ mut_vec vec_slice(vec self, usz first_index, usz second_index);
 /**
  * @brief Creates a copy of a vector.
  *
+ * The copy shares the item buffer of `self` and the actual copy only happens
+ * when either of them is first modified through vec_set, vec_modify,
+ * vec_push, vec_foreach or another mutating function (a single memcpy in
+ * flat mode, a copy of each item otherwise). Small vectors, views and
+ * vectors that views were made of are copied right away.
+ *
  * @param self The vector to copy.
  * @return Returns a new vector that is a copy of the original vector.
  */
 mut_vec vec_copy(vec self);
 
+/**
+ * @brief Creates a read-only view of a range of a vector without copying.
+ *
+ * The view borrows the items of `self` and is accepted by every function
+ * taking a `vec`. It lives in `storage` and needs no vec_destroy. Any change
+ * to the length or capacity of `self` invalidates the view. A `self` sharing
+ * its buffer with copies is unshared first, and later copies of it are deep,
+ * so writes through the view or to `self` never reach a copy. Use vec_copy
+ * on the view to get an owned deep copy.
+ *
+ * @param storage The memory to place the view in.
+ * @param self The vector.
+ * @param first_index The index of the first element in the view.
+ * @param second_index The index past the last element in the view.
+ * @return Returns the view, or NULL if the indices are invalid.
+ */
+vec vec_view(vec_storage *storage, vec self, usz first_index,
+             usz second_index);
+
+/**
+ * @brief Creates a read-only view of every `step`-th item of a range.
+ *
+ * Behaves like vec_view, starting at `first_index`.
+ *
+ * @param storage The memory to place the view in.
+ * @param self The vector.
+ * @param first_index The index of the first element in the view.
+ * @param second_index The index past the last element of the range.
+ * @param step The distance between consecutive items of the view.
+ * @return Returns the view, or NULL if the indices or step are invalid.
+ */
+vec vec_view_strided(vec_storage *storage, vec self, usz first_index,
+                     usz second_index, usz step);
+
 /**
  * @brief Applies a function to each item in the vector.
  *
@@ -108,6 +239,17 @@ vec vec_map(vec self, void (*apply)(vec_item item));
 vec vec_map2(vec self, vec other,
              void (*apply)(vec_item item_a, vec_item item_b));
 
+/**
+ * @brief Applies a function taking a context to each item of a copy of the
+ * vector.
+ *
+ * @param self The vector to apply the function to.
+ * @param apply The function to apply to each item.
+ * @param ctx The context passed to `apply`.
+ * @return A new vector with the applied function.
+ */
+vec vec_map_ctx(vec self, void (*apply)(void *ctx, vec_item item), void *ctx);
+
 // information functions
 
 /**
@@ -126,6 +268,14 @@ bool vec_empty(vec self);
  */
 mut_usz vec_length(vec self);
 
+/**
+ * @brief Get the number of items the vector can hold without growing.
+ *
+ * @param self The vector.
+ * @return The capacity of the vector.
+ */
+mut_usz vec_capacity(vec self);
+
 /**
  * @brief Prints the elements of a vector.
  *
@@ -148,11 +298,36 @@ void vec_print(vec self, void (*print)(vec_item item));
  */
 void vec_println(vec self, void (*print)(vec_item item));
 
+/**
+ * @brief Prints the elements of a vector with a print function taking a
+ * context.
+ *
+ * @param self The vector to be printed.
+ * @param print The function used to print each element of the vector.
+ * @param ctx The context passed to `print`, e.g. a `FILE *`.
+ */
+void vec_print_ctx(vec self, void (*print)(void *ctx, vec_item item),
+                   void *ctx);
+
+/**
+ * @brief Prints the elements of a vector with a print function taking a
+ * context, and a newline at the end.
+ *
+ * @param self The vector to be printed.
+ * @param print The function used to print each element of the vector.
+ * @param ctx The context passed to `print`.
+ */
+void vec_println_ctx(vec self, void (*print)(void *ctx, vec_item item),
+                     void *ctx);
+
 // modification functions
 
 /**
  * @brief Applies a function to each item in a vector.
  *
+ * The function may modify the items: a copy sharing its buffer gets its own
+ * buffer first.
+ *
  * @param self The vector.
  * @param apply The function to apply to each item.
  */
@@ -168,6 +343,69 @@ void vec_foreach(vec self, void (*apply)(vec_item item));
 void vec_foreach2(vec self, vec other,
                   void (*apply)(vec_item item_a, vec_item item_b));
 
+/**
+ * @brief Makes room for at least `capacity` items in total.
+ *
+ * @param self The vector.
+ * @param capacity The number of items to make room for.
+ */
+void vec_reserve(mut_vec self, usz capacity);
+
+/**
+ * @brief Releases the capacity not used by the items.
+ *
+ * @param self The vector.
+ */
+void vec_shrink_to_fit(mut_vec self);
+
+/**
+ * @brief Applies a function taking a context to each item in a vector.
+ *
+ * The context carries state such as an accumulator, so reductions need no
+ * global variables.
+ *
+ * @param self The vector.
+ * @param apply The function to apply to each item.
+ * @param ctx The context passed to `apply`.
+ */
+void vec_foreach_ctx(vec self, void (*apply)(void *ctx, vec_item item),
+                     void *ctx);
+
+/**
+ * @brief Applies a function taking a context to each pair of elements from
+ * two vectors.
+ *
+ * @param self The first vector.
+ * @param other The second vector.
+ * @param apply The function to apply to each pair of elements.
+ * @param ctx The context passed to `apply`.
+ */
+void vec_foreach2_ctx(vec self, vec other,
+                      void (*apply)(void *ctx, vec_item item_a,
+                                    vec_item item_b),
+                      void *ctx);
+
+/**
+ * @brief Number of items handed to a batch callback at a time, when they
+ * are not already stored as a contiguous array of item pointers.
+ */
+#define VEC_BATCH_SIZE 256
+
+/**
+ * @brief Hands the items of a vector to a function in contiguous batches.
+ *
+ * One indirect call covers a whole batch. A vector of item pointers is
+ * passed as a single batch straight from its buffer, otherwise the item
+ * pointers are gathered VEC_BATCH_SIZE at a time.
+ *
+ * @param self The vector.
+ * @param apply The function called with each batch of items.
+ * @param ctx The context passed to `apply`.
+ */
+void vec_foreach_batch(vec self,
+                       void (*apply)(void *ctx, vec_item *items, usz count),
+                       void *ctx);
+
 /**
  * @brief Removes the last element from the vector.
  *
@@ -179,6 +417,8 @@ bool vec_pop(mut_vec self);
 /**
  * @brief Sets the value of an element at a specific index in the vector.
  *
+ * In flat mode `item_size` bytes are copied from `item`.
+ *
  * @param self The vector.
  * @param index The index of the element to set.
  * @param item The new value for the element.
@@ -197,14 +437,194 @@ bool vec_set(mut_vec self, usz index, vec_item item);
  */
 bool vec_modify(mut_vec self, usz index, void (*apply)(vec_item item));
 
+/**
+ * @brief Modifies an element at a specific index in the vector using a
+ * function taking a context.
+ *
+ * @param self The vector.
+ * @param index The index of the element to modify.
+ * @param apply The function to apply to the element.
+ * @param ctx The context passed to `apply`.
+ * @return True if the element was successfully modified, false otherwise.
+ */
+bool vec_modify_ctx(mut_vec self, usz index,
+                    void (*apply)(void *ctx, vec_item item), void *ctx);
+
 /**
  * @brief Adds an element to the end of the vector.
  *
+ * In flat mode `item_size` bytes are copied from `item`.
+ *
  * @param self The vector.
  * @param item The element to add.
  */
 void vec_push(mut_vec self, vec_item item);
 
+/**
+ * @brief Adds several elements to the end of the vector at once.
+ *
+ * Makes room once and copies all items with a single memcpy. In flat mode
+ * `items` holds `count` items by value, otherwise `count` item pointers
+ * whose ownership moves to the vector.
+ *
+ * @param self The vector.
+ * @param items The items to add.
+ * @param count The number of items.
+ */
+void vec_extend(mut_vec self, void const *items, usz count);
+
+/**
+ * @brief Inserts several elements before a specific index of the vector.
+ *
+ * Items are laid out as for vec_extend. An index equal to the length appends.
+ *
+ * @param self The vector.
+ * @param index The index to insert the items at.
+ * @param items The items to insert.
+ * @param count The number of items.
+ * @return True if the items were inserted, false if the index is invalid.
+ */
+bool vec_insert_range(mut_vec self, usz index, void const *items, usz count);
+
+/**
+ * @brief Inserts an element before a specific index of the vector.
+ *
+ * The items from the index on are moved up with a single memmove. In flat
+ * mode `item_size` bytes are copied from `item`.
+ *
+ * @param self The vector.
+ * @param index The index to insert the element at.
+ * @param item The element to insert.
+ * @return True if the element was inserted, false if the index is invalid.
+ */
+bool vec_insert_at(mut_vec self, usz index, vec_item item);
+
+/**
+ * @brief Removes the element at a specific index of the vector.
+ *
+ * The items after it are moved down with a single memmove.
+ *
+ * @param self The vector.
+ * @param index The index of the element to remove.
+ * @return True if the element was removed, false if the index is invalid.
+ */
+bool vec_remove_at(mut_vec self, usz index);
+
+/**
+ * @brief Removes the elements in a range of the vector.
+ *
+ * The items after the range are moved down with a single memmove, so
+ * dropping a window from the front costs one move instead of a new vector.
+ *
+ * @param self The vector.
+ * @param first_index The index of the first element to remove.
+ * @param second_index The index past the last element to remove.
+ * @return True if the elements were removed, false if the range is invalid.
+ */
+bool vec_remove_range(mut_vec self, usz first_index, usz second_index);
+
+// reduction and filtering functions
+
+/**
+ * @brief Folds the items of a vector into an accumulator.
+ *
+ * @param self The vector.
+ * @param combine The function merging each item into the accumulator.
+ * @param acc The accumulator, passed to `combine`.
+ */
+void vec_reduce(vec self, void (*combine)(void *acc, vec_item item),
+                void *acc);
+
+/**
+ * @brief Checks if any item of the vector satisfies a predicate.
+ *
+ * Stops at the first matching item.
+ *
+ * @param self The vector.
+ * @param pred The predicate.
+ * @param ctx The context passed to `pred`.
+ * @return True if an item satisfies the predicate, false otherwise.
+ */
+bool vec_any(vec self, bool (*pred)(void *ctx, vec_item item), void *ctx);
+
+/**
+ * @brief Checks if every item of the vector satisfies a predicate.
+ *
+ * Stops at the first item that does not match.
+ *
+ * @param self The vector.
+ * @param pred The predicate.
+ * @param ctx The context passed to `pred`.
+ * @return True if all items satisfy the predicate, false otherwise.
+ */
+bool vec_all(vec self, bool (*pred)(void *ctx, vec_item item), void *ctx);
+
+/**
+ * @brief Counts the items of the vector satisfying a predicate.
+ *
+ * @param self The vector.
+ * @param pred The predicate.
+ * @param ctx The context passed to `pred`.
+ * @return The number of matching items.
+ */
+mut_usz vec_count_if(vec self, bool (*pred)(void *ctx, vec_item item),
+                     void *ctx);
+
+/**
+ * @brief Copies the items satisfying a predicate into a new vector.
+ *
+ * Items are copied as by vec_slice.
+ *
+ * @param self The vector.
+ * @param pred The predicate.
+ * @param ctx The context passed to `pred`.
+ * @return Returns a new vector.
+ */
+mut_vec vec_filter(vec self, bool (*pred)(void *ctx, vec_item item),
+                   void *ctx);
+
+/**
+ * @brief Maps the items of a vector and keeps those satisfying a predicate.
+ *
+ * A single pass: each item is copied, `apply` modifies the copy and the copy
+ * is kept if it satisfies `pred`, otherwise it is destroyed right away.
+ *
+ * @param self The vector.
+ * @param apply The function to apply to each copy, NULL to only filter.
+ * @param pred The predicate tested on the mapped copy.
+ * @param ctx The context passed to `apply` and `pred`.
+ * @return Returns a new vector.
+ */
+mut_vec vec_map_filter(vec self, void (*apply)(void *ctx, vec_item item),
+                       bool (*pred)(void *ctx, vec_item item), void *ctx);
+
+/**
+ * @brief Keeps only the items satisfying a predicate, in place.
+ *
+ * Kept items are compacted towards the front in their original order and the
+ * others are destroyed. Nothing is allocated.
+ *
+ * @param self The vector.
+ * @param pred The predicate.
+ * @param ctx The context passed to `pred`.
+ */
+void vec_retain(mut_vec self, bool (*pred)(void *ctx, vec_item item),
+                void *ctx);
+
+/**
+ * @brief Moves the items satisfying a predicate before the others, in place.
+ *
+ * The order inside each group is not preserved.
+ *
+ * @param self The vector.
+ * @param pred The predicate.
+ * @param ctx The context passed to `pred`.
+ * @return The number of items satisfying the predicate, which is the index
+ * of the first item of the second group.
+ */
+mut_usz vec_partition(mut_vec self, bool (*pred)(void *ctx, vec_item item),
+                      void *ctx);
+
 /**
  * @brief Initializes an svec data structure.
  *
@@ -215,6 +635,51 @@ void vec_push(mut_vec self, vec_item item);
  */
 void *_svec_init(usz size);
 
+/**
+ * @brief Initializes an svec data structure using a custom allocator.
+ *
+ * @param size The size of each element in the svec.
+ * @param allocator The allocator for the svec block, NULL for malloc.
+ * @return A pointer to the initialized svec data structure.
+ */
+void *_svec_init_with(usz size, vec_allocator *allocator);
+
+/**
+ * @brief Initializes an svec with room for a number of elements.
+ *
+ * @param size The size of each element in the svec.
+ * @param capacity The number of elements to make room for.
+ * @param allocator The allocator for the svec block, NULL for malloc.
+ * @return A pointer to the initialized svec data structure.
+ */
+void *_svec_with_capacity(usz size, usz capacity, vec_allocator *allocator);
+
+/**
+ * @brief Makes room for at least `capacity` elements in total.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @param capacity The number of elements to make room for.
+ * @return The pointer to the svec, which moves when it is reallocated.
+ */
+void *_svec_reserve(void *svec_ptr, usz capacity);
+
+/**
+ * @brief Releases the capacity not used by the elements.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @return The pointer to the svec, which moves when it is reallocated.
+ */
+void *_svec_shrink_to_fit(void *svec_ptr);
+
+/**
+ * @brief Frees an svec through the allocator it was created with.
+ *
+ * Can be used as the `destroy` function of a vector of svecs.
+ *
+ * @param svec_ptr A pointer to the svec, may be NULL.
+ */
+void svec_destroy(void *svec_ptr);
+
 /**
  * @brief Pushes a value into a dynamic array.
  *
@@ -225,8 +690,19 @@ void *_svec_init(usz size);
  *
  * @param svec_ptr A pointer to the dynamic array.
  * @param value The value to be pushed into the array.
+ * @return The pointer to the array, which moves when it is reallocated.
+ */
+void *_svec_push(void *svec_ptr, void *value);
+
+/**
+ * @brief Appends an array of values to a dynamic array with a single copy.
+ *
+ * @param svec_ptr A pointer to the dynamic array.
+ * @param array The values to append.
+ * @param count The number of values.
+ * @return The pointer to the array, which moves when it is reallocated.
  */
-void _svec_push(void *svec_ptr, void *value);
+void *_svec_append(void *svec_ptr, void const *array, usz count);
 
 /**
  * @brief Macro for initializing an svec data structure.
@@ -239,6 +715,43 @@ void _svec_push(void *svec_ptr, void *value);
  */
 #define svec_init(TYPE) _svec_init(sizeof(TYPE))
 
+/**
+ * @brief Macro for initializing an svec using a custom allocator.
+ *
+ * @param TYPE The type of each element in the svec.
+ * @param ALLOCATOR The allocator for the svec block.
+ * @return A pointer to the initialized svec data structure.
+ */
+#define svec_init_with(TYPE, ALLOCATOR)                                        \
+  _svec_init_with(sizeof(TYPE), (ALLOCATOR))
+
+/**
+ * @brief Macro for initializing an svec with room for a number of elements.
+ *
+ * @param TYPE The type of each element in the svec.
+ * @param CAPACITY The number of elements to make room for.
+ * @return A pointer to the initialized svec data structure.
+ */
+#define svec_with_capacity(TYPE, CAPACITY)                                     \
+  _svec_with_capacity(sizeof(TYPE), (CAPACITY), NULL)
+
+/**
+ * @brief Makes room for at least `CAPACITY` elements in total.
+ *
+ * @param SVEC_PTR The pointer to the vector, updated if the vector moves.
+ * @param CAPACITY The number of elements to make room for.
+ */
+#define svec_reserve(SVEC_PTR, CAPACITY)                                       \
+  ((SVEC_PTR) = _svec_reserve((SVEC_PTR), (CAPACITY)))
+
+/**
+ * @brief Releases the capacity not used by the elements.
+ *
+ * @param SVEC_PTR The pointer to the vector, updated if the vector moves.
+ */
+#define svec_shrink_to_fit(SVEC_PTR)                                           \
+  ((SVEC_PTR) = _svec_shrink_to_fit((SVEC_PTR)))
+
 /**
  * @brief Pushes a value onto the vector.
  *
@@ -248,9 +761,19 @@ void _svec_push(void *svec_ptr, void *value);
 #define svec_push(SVEC_PTR, VALUE)                                             \
   do {                                                                         \
     void *temp_ptr = ((void *)(VALUE));                                        \
-    _svec_push((SVEC_PTR), &temp_ptr);                                         \
+    (SVEC_PTR) = _svec_push((SVEC_PTR), &temp_ptr);                            \
   } while (0)
 
+/**
+ * @brief Appends an array of values onto the vector.
+ *
+ * @param SVEC_PTR The pointer to the vector, updated if the vector moves.
+ * @param ARRAY The pointer to the values, of the element type.
+ * @param COUNT The number of values.
+ */
+#define svec_append_array(SVEC_PTR, ARRAY, COUNT)                              \
+  ((SVEC_PTR) = _svec_append((SVEC_PTR), (ARRAY), (COUNT)))
+
 /**
  * @brief Pops a value from the vector.
  *
@@ -273,6 +796,14 @@ void _svec_push(void *svec_ptr, void *value);
  */
 #define svec_length(SVEC_PTR) ((struct _svec_mdi *)(void *)(SVEC_PTR))->length
 
+/**
+ * @brief Returns the number of elements the vector can hold without growing.
+ *
+ * @param SVEC_PTR The pointer to the vector.
+ * @return The capacity of the vector.
+ */
+#define svec_capacity(SVEC_PTR) ((struct _svec_mdi *)(void *)(SVEC_PTR))->alloc
+
 /**
  * @brief Check if the given svec is empty.
  *
@@ -281,6 +812,15 @@ void _svec_push(void *svec_ptr, void *value);
  */
 #define svec_empty(SVEC_PTR) ((struct _svec_mdi *)(SVEC_PTR))->length == 0
 
+/**
+ * @brief Returns a pointer to the first element of the vector.
+ *
+ * @param SVEC_PTR The pointer to the vector.
+ * @return The untyped pointer to the elements.
+ */
+#define svec_data(SVEC_PTR)                                                    \
+  ((void *)((struct _svec_mdi *)(void *)(SVEC_PTR) + 1))
+
 /**
  * @brief Returns the value at the specified index in the vector.
  *
@@ -294,6 +834,22 @@ void _svec_push(void *svec_ptr, void *value);
        struct _svec_mdi))[(INDEX) *                                            \
                           ((struct _svec_mdi *)(void *)(SVEC_PTR))->type_size]
 
+#ifdef __GNUC__
+/**
+ * @brief Returns the element at the specified index, typed as the vector.
+ *
+ * The element has the type `SVEC_PTR` points to, so its size is known at
+ * compile time instead of being read from the header. Needs `__typeof__`,
+ * so it is only defined for GNU C compilers.
+ *
+ * @param SVEC_PTR The typed pointer to the vector, not `void *`.
+ * @param INDEX The index of the element.
+ * @return The element, an lvalue.
+ */
+#define svec_get(SVEC_PTR, INDEX)                                              \
+  ((__typeof__(SVEC_PTR))svec_data(SVEC_PTR))[INDEX]
+#endif
+
 /**
  * @brief Calculate the size of a svec by type.
  *
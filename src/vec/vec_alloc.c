@@ -0,0 +1,312 @@
+#include "vec_alloc.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define VEC_ALIGN (_Alignof(max_align_t))
+
+/**
+ * @brief Rounds a size up to the maximal fundamental alignment.
+ *
+ * @param size The size to round.
+ * @return The rounded size.
+ */
+static mut_usz _align_up(usz size) {
+  return (size + VEC_ALIGN - 1) & ~(VEC_ALIGN - 1);
+}
+
+/**
+ * @struct _arena_block
+ * @brief A block of an arena.
+ */
+struct _arena_block {
+  struct _arena_block *next; /**< The previously allocated block. */
+  mut_usz size;              /**< The size of the data. */
+  mut_usz used;              /**< The number of bytes handed out. */
+  max_align_t data[];        /**< The memory of the block. */
+};
+
+/**
+ * @struct vec_arena
+ * @brief A bump allocator.
+ */
+struct vec_arena {
+  struct vec_allocator allocator; /**< The allocator of the arena. */
+  struct _arena_block *blocks;    /**< The blocks, newest first. */
+  mut_usz block_size;             /**< The default size of a block. */
+  void *last;                     /**< The most recent allocation. */
+};
+
+/**
+ * @struct _pool_chunk
+ * @brief A chunk of blocks of a pool.
+ */
+struct _pool_chunk {
+  struct _pool_chunk *next; /**< The previously allocated chunk. */
+  max_align_t data[];       /**< The blocks of the chunk. */
+};
+
+/**
+ * @struct vec_pool
+ * @brief A pool of fixed-size blocks.
+ */
+struct vec_pool {
+  struct vec_allocator allocator; /**< The allocator of the pool. */
+  struct _pool_chunk *chunks;     /**< The chunks, newest first. */
+  void *free_list;                /**< The free blocks. */
+  mut_usz block_size;             /**< The size of a block. */
+  mut_usz chunk_blocks;           /**< The number of blocks in a chunk. */
+};
+
+// arena functions
+static void *_arena_allocate(void *ctx, usz size) {
+  struct vec_arena *arena = ctx;
+  usz aligned = _align_up(size);
+  struct _arena_block *block = arena->blocks;
+
+  if (block == NULL || block->size - block->used < aligned) {
+    usz block_size = aligned > arena->block_size ? aligned : arena->block_size;
+    block = malloc(sizeof *block + block_size);
+    if (block == NULL) {
+      return NULL;
+    }
+
+    *block = (struct _arena_block){
+        .next = arena->blocks, .size = block_size, .used = 0};
+    arena->blocks = block;
+  }
+
+  void *ptr = (char *)block->data + block->used;
+  block->used += aligned;
+  arena->last = ptr;
+  return ptr;
+}
+
+static void _arena_release(void *ctx, void *ptr, usz size) {
+  struct vec_arena *arena = ctx;
+  (void)size;
+
+  if (ptr != NULL && ptr == arena->last) {
+    arena->blocks->used = (usz)((char *)ptr - (char *)arena->blocks->data);
+    arena->last = NULL;
+  }
+}
+
+static void *_arena_reallocate(void *ctx, void *ptr, usz old_size,
+                               usz new_size) {
+  struct vec_arena *arena = ctx;
+  struct _arena_block *block = arena->blocks;
+
+  if (ptr != NULL && ptr == arena->last) {
+    usz offset = (usz)((char *)ptr - (char *)block->data);
+    usz aligned = _align_up(new_size);
+    if (block->size - offset >= aligned) {
+      block->used = offset + aligned;
+      return ptr;
+    }
+  }
+
+  void *new_ptr = _arena_allocate(arena, new_size);
+  if (new_ptr != NULL && ptr != NULL) {
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+  }
+
+  return new_ptr;
+}
+
+struct vec_arena *vec_arena_init(usz block_size) {
+  struct vec_arena *arena = malloc(sizeof *arena);
+  if (arena == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  *arena = (struct vec_arena){
+      .allocator = {.allocate = _arena_allocate,
+                    .reallocate = _arena_reallocate,
+                    .release = _arena_release,
+                    .ctx = arena},
+      .blocks = NULL,
+      .block_size = _align_up(block_size ? block_size : VEC_ARENA_BLOCK_SIZE),
+      .last = NULL};
+
+  return arena;
+}
+
+void vec_arena_destroy(struct vec_arena *arena) {
+  if (arena == NULL) {
+    return;
+  }
+
+  struct _arena_block *block = arena->blocks;
+  while (block) {
+    struct _arena_block *next = block->next;
+    free(block);
+    block = next;
+  }
+
+  free(arena);
+}
+
+void vec_arena_reset(struct vec_arena *arena) {
+  struct _arena_block *block = arena->blocks;
+  if (block == NULL) {
+    return;
+  }
+
+  while (block->next) {
+    struct _arena_block *next = block->next;
+    free(block);
+    block = next;
+  }
+
+  block->used = 0;
+  arena->blocks = block;
+  arena->last = NULL;
+}
+
+vec_allocator *vec_arena_allocator(struct vec_arena *arena) {
+  return &arena->allocator;
+}
+
+static _Thread_local struct vec_arena *thread_arena = NULL;
+
+struct vec_arena *vec_thread_arena(void) {
+  if (thread_arena == NULL) {
+    thread_arena = vec_arena_init(VEC_ARENA_BLOCK_SIZE);
+  }
+
+  return thread_arena;
+}
+
+void vec_thread_arena_release(void) {
+  vec_arena_destroy(thread_arena);
+  thread_arena = NULL;
+}
+
+// pool functions
+
+/**
+ * @brief Threads every block of a chunk onto the free list of a pool.
+ *
+ * @param pool The pool.
+ * @param chunk The chunk.
+ */
+static void _pool_thread_chunk(struct vec_pool *pool,
+                               struct _pool_chunk *chunk) {
+  char *block = (char *)chunk->data;
+  for (mut_usz i = 0; i < pool->chunk_blocks; ++i, block += pool->block_size) {
+    *(void **)(void *)block = pool->free_list;
+    pool->free_list = block;
+  }
+}
+
+void *vec_pool_get(struct vec_pool *pool) {
+  if (pool->free_list == NULL) {
+    struct _pool_chunk *chunk =
+        malloc(sizeof *chunk + pool->block_size * pool->chunk_blocks);
+    if (chunk == NULL) {
+      OUT_OF_MEMORY;
+    }
+
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+    _pool_thread_chunk(pool, chunk);
+  }
+
+  void *block = pool->free_list;
+  pool->free_list = *(void **)block;
+  return block;
+}
+
+void vec_pool_put(struct vec_pool *pool, void *block) {
+  if (block == NULL) {
+    return;
+  }
+
+  *(void **)block = pool->free_list;
+  pool->free_list = block;
+}
+
+static void *_pool_allocate(void *ctx, usz size) {
+  struct vec_pool *pool = ctx;
+  return size <= pool->block_size ? vec_pool_get(pool) : malloc(size);
+}
+
+static void _pool_release(void *ctx, void *ptr, usz size) {
+  struct vec_pool *pool = ctx;
+  if (size <= pool->block_size) {
+    vec_pool_put(pool, ptr);
+  } else {
+    free(ptr);
+  }
+}
+
+static void *_pool_reallocate(void *ctx, void *ptr, usz old_size,
+                              usz new_size) {
+  struct vec_pool *pool = ctx;
+  bool old_pooled = old_size <= pool->block_size;
+  bool new_pooled = new_size <= pool->block_size;
+
+  if (old_pooled && new_pooled) {
+    return ptr;
+  }
+
+  if (!old_pooled && !new_pooled) {
+    return realloc(ptr, new_size);
+  }
+
+  void *new_ptr = _pool_allocate(pool, new_size);
+  if (new_ptr != NULL) {
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    _pool_release(pool, ptr, old_size);
+  }
+
+  return new_ptr;
+}
+
+struct vec_pool *vec_pool_init(usz block_size, usz chunk_blocks) {
+  struct vec_pool *pool = malloc(sizeof *pool);
+  if (pool == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  usz min_size = block_size < sizeof(void *) ? sizeof(void *) : block_size;
+  *pool = (struct vec_pool){
+      .allocator = {.allocate = _pool_allocate,
+                    .reallocate = _pool_reallocate,
+                    .release = _pool_release,
+                    .ctx = pool},
+      .chunks = NULL,
+      .free_list = NULL,
+      .block_size = _align_up(min_size),
+      .chunk_blocks = chunk_blocks ? chunk_blocks : VEC_INITIAL_ALLOC_SIZE};
+
+  return pool;
+}
+
+void vec_pool_destroy(struct vec_pool *pool) {
+  if (pool == NULL) {
+    return;
+  }
+
+  struct _pool_chunk *chunk = pool->chunks;
+  while (chunk) {
+    struct _pool_chunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+
+  free(pool);
+}
+
+void vec_pool_reset(struct vec_pool *pool) {
+  pool->free_list = NULL;
+  for (struct _pool_chunk *chunk = pool->chunks; chunk; chunk = chunk->next) {
+    _pool_thread_chunk(pool, chunk);
+  }
+}
+
+vec_allocator *vec_pool_allocator(struct vec_pool *pool) {
+  return &pool->allocator;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file vec_alloc.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Arena and pool allocators for vectors
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @struct  vec_arena
+ * @brief A bump allocator that frees all of its memory in one reset.
+ *
+ * Releasing a block only gives memory back when it is the most recent
+ * allocation, so vectors living in an arena are freed by resetting it.
+ */
+struct vec_arena;
+
+/**
+ * @struct  vec_pool
+ * @brief A pool of fixed-size blocks.
+ *
+ * Blocks up to the block size of the pool are served from a free list, larger
+ * requests (like the element array of a vector) fall back to malloc.
+ */
+struct vec_pool;
+
+/**
+ * @brief Default size of an arena block.
+ */
+#define VEC_ARENA_BLOCK_SIZE ((usz)64 * 1024)
+
+// arena functions
+
+/**
+ * @brief Initializes a new arena.
+ *
+ * @param block_size The size of each block the arena carves allocations from.
+ * @return Returns a new arena.
+ */
+struct vec_arena *vec_arena_init(usz block_size);
+
+/**
+ * @brief Destroys an arena and frees all of its memory.
+ *
+ * @param arena The arena to destroy.
+ */
+void vec_arena_destroy(struct vec_arena *arena);
+
+/**
+ * @brief Frees every allocation of the arena at once.
+ *
+ * The first block is kept for reuse. Vectors allocated from the arena must not
+ * be used after a reset.
+ *
+ * @param arena The arena to reset.
+ */
+void vec_arena_reset(struct vec_arena *arena);
+
+/**
+ * @brief Returns the allocator of an arena.
+ *
+ * @param arena The arena.
+ * @return The allocator, valid for the lifetime of the arena.
+ */
+vec_allocator *vec_arena_allocator(struct vec_arena *arena);
+
+/**
+ * @brief Returns the arena of the calling thread.
+ *
+ * The arena is created on first use with VEC_ARENA_BLOCK_SIZE blocks.
+ *
+ * @return The arena of the calling thread.
+ */
+struct vec_arena *vec_thread_arena(void);
+
+/**
+ * @brief Destroys the arena of the calling thread.
+ *
+ * Should be called before a thread that used vec_thread_arena exits.
+ */
+void vec_thread_arena_release(void);
+
+// pool functions
+
+/**
+ * @brief Initializes a new pool.
+ *
+ * @param block_size The size of each block of the pool.
+ * @param chunk_blocks The number of blocks allocated at once when the pool
+ * runs out.
+ * @return Returns a new pool.
+ */
+struct vec_pool *vec_pool_init(usz block_size, usz chunk_blocks);
+
+/**
+ * @brief Destroys a pool and frees all of its memory.
+ *
+ * @param pool The pool to destroy.
+ */
+void vec_pool_destroy(struct vec_pool *pool);
+
+/**
+ * @brief Returns every block to the free list at once.
+ *
+ * @param pool The pool to reset.
+ */
+void vec_pool_reset(struct vec_pool *pool);
+
+/**
+ * @brief Takes a block from the pool.
+ *
+ * @param pool The pool.
+ * @return A block of the pool's block size.
+ */
+void *vec_pool_get(struct vec_pool *pool);
+
+/**
+ * @brief Gives a block back to the pool.
+ *
+ * @param pool The pool.
+ * @param block The block taken with vec_pool_get, may be NULL.
+ */
+void vec_pool_put(struct vec_pool *pool, void *block);
+
+/**
+ * @brief Returns the allocator of a pool.
+ *
+ * @param pool The pool.
+ * @return The allocator, valid for the lifetime of the pool.
+ */
+vec_allocator *vec_pool_allocator(struct vec_pool *pool);
@@ -0,0 +1,228 @@
+#include "vec_chunked.h"
+#include "vec_deque.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+
+/**
+ * @struct _chunk
+ * @brief A block of items, filled from the front and drained from the front.
+ */
+struct _chunk {
+  mut_usz first;       /**< The number of items drained. */
+  mut_usz length;      /**< The number of items written. */
+  max_align_t items[]; /**< The items. */
+};
+
+/**
+ * @struct vec_chunked
+ * @brief A chunked vector.
+ */
+struct vec_chunked {
+  struct vec_deque *chunks; /**< Pointers to the chunks, front first. */
+  struct _chunk *spare;     /**< A drained chunk kept for reuse, or NULL. */
+  mut_usz length;           /**< The number of items. */
+  mut_usz item_size;        /**< The size of an item. */
+  mut_usz chunk_items;      /**< The number of items of a chunk. */
+  vec_allocator *allocator; /**< The allocator, NULL for malloc. */
+  bool (*on_full)(void *ctx, void *items, usz count); /**< Or NULL. */
+  void *ctx; /**< The context of `on_full`. */
+};
+
+static mut_usz _chunk_size(struct vec_chunked const *self) {
+  return sizeof(struct _chunk) + self->item_size * self->chunk_items;
+}
+
+static struct _chunk *_chunk_at(struct vec_chunked const *self, usz index) {
+  return *(struct _chunk **)vec_deque_at(self->chunks, index);
+}
+
+static unsigned char *_item(struct vec_chunked const *self,
+                            struct _chunk *chunk, usz index) {
+  return (unsigned char *)chunk->items + index * self->item_size;
+}
+
+/**
+ * @brief Returns the chunk to push into, adding one when the last is full.
+ *
+ * @param self The vector.
+ * @return The last chunk, with room for at least one item.
+ */
+static struct _chunk *_tail(struct vec_chunked *self) {
+  usz count = vec_deque_length(self->chunks);
+  if (count != 0) {
+    struct _chunk *last = _chunk_at(self, count - 1);
+    if (last->length != self->chunk_items) {
+      return last;
+    }
+  }
+
+  struct _chunk *chunk = self->spare;
+  self->spare = NULL;
+  if (chunk == NULL) {
+    chunk = _vec_allocate(self->allocator, _chunk_size(self));
+  }
+  chunk->first = 0;
+  chunk->length = 0;
+  vec_deque_push_back(self->chunks, &chunk);
+  return chunk;
+}
+
+/**
+ * @brief Frees a drained chunk, or keeps it as the spare.
+ */
+static void _recycle(struct vec_chunked *self, struct _chunk *chunk) {
+  if (self->spare == NULL) {
+    self->spare = chunk;
+  } else {
+    _vec_release(self->allocator, chunk, _chunk_size(self));
+  }
+}
+
+/**
+ * @brief Hands a chunk that just filled up to the callback.
+ */
+static void _filled(struct vec_chunked *self, struct _chunk *chunk) {
+  if (self->on_full != NULL &&
+      self->on_full(self->ctx, _item(self, chunk, chunk->first),
+                    chunk->length - chunk->first)) {
+    vec_chunked_drain_front(self, self->length);
+  }
+}
+
+struct vec_chunked *vec_chunked_init(usz item_size, usz chunk_items) {
+  return vec_chunked_init_with(item_size, chunk_items, NULL);
+}
+
+struct vec_chunked *vec_chunked_init_with(usz item_size, usz chunk_items,
+                                          vec_allocator *allocator) {
+  mut_usz items = chunk_items;
+  if (items == 0) {
+    items = item_size && item_size < VEC_CHUNK_SIZE ? VEC_CHUNK_SIZE / item_size
+                                                    : 1;
+  }
+  if (item_size &&
+      items > (USZ_MAX - sizeof(struct _chunk)) / item_size) {
+    OUT_OF_MEMORY;
+  }
+
+  struct vec_chunked *self = _vec_allocate(allocator, sizeof *self);
+  self->chunks = vec_deque_init_with(sizeof(struct _chunk *), allocator);
+  self->spare = NULL;
+  self->length = 0;
+  self->item_size = item_size;
+  self->chunk_items = items;
+  self->allocator = allocator;
+  self->on_full = NULL;
+  self->ctx = NULL;
+  return self;
+}
+
+void vec_chunked_destroy(struct vec_chunked *self) {
+  if (self == NULL) {
+    return;
+  }
+
+  struct _chunk *chunk = NULL;
+  while (vec_deque_pop_front(self->chunks, &chunk)) {
+    _vec_release(self->allocator, chunk, _chunk_size(self));
+  }
+  if (self->spare != NULL) {
+    _vec_release(self->allocator, self->spare, _chunk_size(self));
+  }
+
+  vec_deque_destroy(self->chunks);
+  _vec_release(self->allocator, self, sizeof *self);
+}
+
+void vec_chunked_on_full(struct vec_chunked *self,
+                         bool (*on_full)(void *ctx, void *items, usz count),
+                         void *ctx) {
+  self->on_full = on_full;
+  self->ctx = ctx;
+}
+
+mut_usz vec_chunked_length(struct vec_chunked const *self) {
+  return self->length;
+}
+
+mut_usz vec_chunked_chunk_items(struct vec_chunked const *self) {
+  return self->chunk_items;
+}
+
+vec_item vec_chunked_at(struct vec_chunked const *self, usz index) {
+  if (index >= self->length) {
+    return NULL;
+  }
+
+  // only the front chunk can be partly drained
+  usz offset = _chunk_at(self, 0)->first + index;
+  return _item(self, _chunk_at(self, offset / self->chunk_items),
+               offset % self->chunk_items);
+}
+
+void vec_chunked_push(struct vec_chunked *self, void const *item) {
+  vec_chunked_extend(self, item, 1);
+}
+
+void vec_chunked_extend(struct vec_chunked *self, void const *items,
+                        usz count) {
+  unsigned char const *source = items;
+  for (mut_usz done = 0; done < count;) {
+    struct _chunk *chunk = _tail(self);
+    usz room = self->chunk_items - chunk->length;
+    usz run = count - done < room ? count - done : room;
+    memcpy(_item(self, chunk, chunk->length), source + done * self->item_size,
+           run * self->item_size);
+    chunk->length += run;
+    self->length += run;
+    done += run;
+
+    if (chunk->length == self->chunk_items) {
+      _filled(self, chunk);
+    }
+  }
+
+  VEC_STAT(_vec_stats_push(NULL, count));
+}
+
+mut_usz vec_chunked_drain_front(struct vec_chunked *self, usz count) {
+  mut_usz drained = 0;
+  while (drained < count && self->length != 0) {
+    struct _chunk *chunk = _chunk_at(self, 0);
+    usz left = chunk->length - chunk->first;
+    usz run = count - drained < left ? count - drained : left;
+    chunk->first += run;
+    self->length -= run;
+    drained += run;
+
+    if (chunk->first == chunk->length) {
+      vec_deque_pop_front(self->chunks, NULL);
+      _recycle(self, chunk);
+    }
+  }
+
+  return drained;
+}
+
+void vec_chunked_foreach_ctx(struct vec_chunked const *self,
+                             void (*apply)(void *ctx, vec_item item),
+                             void *ctx) {
+  usz count = vec_deque_length(self->chunks);
+  for (mut_usz i = 0; i < count; ++i) {
+    struct _chunk *chunk = _chunk_at(self, i);
+    for (mut_usz j = chunk->first; j < chunk->length; ++j) {
+      apply(ctx, _item(self, chunk, j));
+    }
+  }
+}
+
+void vec_chunked_foreach_batch(struct vec_chunked const *self,
+                               void (*apply)(void *ctx, void *items,
+                                             usz count),
+                               void *ctx) {
+  usz count = vec_deque_length(self->chunks);
+  for (mut_usz i = 0; i < count; ++i) {
+    struct _chunk *chunk = _chunk_at(self, i);
+    apply(ctx, _item(self, chunk, chunk->first), chunk->length - chunk->first);
+  }
+}
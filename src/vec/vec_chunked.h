@@ -0,0 +1,155 @@
+/**
+ * @file vec_chunked.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Chunked vector appending into fixed-size blocks
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @struct  vec_chunked
+ * @brief A vector of items stored by value in fixed-size chunks.
+ *
+ * Items never move once pushed: a full chunk is followed by a new one, so a
+ * push costs at most one chunk allocation and never a copy of older items.
+ * Draining from the front frees whole chunks, keeping one spare chunk to
+ * reuse. A callback can be told when a chunk fills, to flush it to a sink
+ * while the producer keeps pushing.
+ */
+struct vec_chunked;
+
+/**
+ * @brief Default size of a chunk in bytes.
+ */
+#define VEC_CHUNK_SIZE ((usz)64 * 1024)
+
+/**
+ * @brief Initializes a chunked vector using malloc.
+ *
+ * @param item_size The size of an item.
+ * @param chunk_items The number of items of a chunk, 0 for as many as fit
+ * in VEC_CHUNK_SIZE.
+ * @return Returns a new chunked vector.
+ */
+struct vec_chunked *vec_chunked_init(usz item_size, usz chunk_items);
+
+/**
+ * @brief Initializes a chunked vector using a custom allocator.
+ *
+ * @param item_size The size of an item.
+ * @param chunk_items The number of items of a chunk, 0 for as many as fit
+ * in VEC_CHUNK_SIZE.
+ * @param allocator The allocator for the vector and its chunks, NULL for
+ * malloc.
+ * @return Returns a new chunked vector.
+ */
+struct vec_chunked *vec_chunked_init_with(usz item_size, usz chunk_items,
+                                          vec_allocator *allocator);
+
+/**
+ * @brief Frees a chunked vector and its chunks.
+ *
+ * @param self The vector, may be NULL.
+ */
+void vec_chunked_destroy(struct vec_chunked *self);
+
+/**
+ * @brief Sets the function called each time a chunk fills up.
+ *
+ * The function receives the items of the chunk that were not drained yet.
+ * Returning true drains the whole vector, which frees the chunk once it has
+ * been flushed.
+ *
+ * @param self The vector.
+ * @param on_full The function, NULL for none.
+ * @param ctx The context passed to `on_full`.
+ */
+void vec_chunked_on_full(struct vec_chunked *self,
+                         bool (*on_full)(void *ctx, void *items, usz count),
+                         void *ctx);
+
+/**
+ * @brief Get the number of items in the vector.
+ *
+ * @param self The vector.
+ * @return The number of items.
+ */
+mut_usz vec_chunked_length(struct vec_chunked const *self);
+
+/**
+ * @brief Get the number of items of a chunk.
+ *
+ * @param self The vector.
+ * @return The number of items of a chunk.
+ */
+mut_usz vec_chunked_chunk_items(struct vec_chunked const *self);
+
+/**
+ * @brief Returns the item at an index.
+ *
+ * The address stays valid until the item is drained.
+ *
+ * @param self The vector.
+ * @param index The index of the item.
+ * @return The address of the item, NULL if the index is invalid.
+ */
+vec_item vec_chunked_at(struct vec_chunked const *self, usz index);
+
+/**
+ * @brief Adds a copy of an item at the end.
+ *
+ * @param self The vector.
+ * @param item The address of the item.
+ */
+void vec_chunked_push(struct vec_chunked *self, void const *item);
+
+/**
+ * @brief Adds copies of several items at the end.
+ *
+ * Copies a run of items into each chunk with a single memcpy.
+ *
+ * @param self The vector.
+ * @param items The items.
+ * @param count The number of items.
+ */
+void vec_chunked_extend(struct vec_chunked *self, void const *items,
+                        usz count);
+
+/**
+ * @brief Removes items from the front.
+ *
+ * @param self The vector.
+ * @param count The largest number of items to remove.
+ * @return The number of items removed.
+ */
+mut_usz vec_chunked_drain_front(struct vec_chunked *self, usz count);
+
+/**
+ * @brief Applies a function taking a context to each item, in order.
+ *
+ * @param self The vector.
+ * @param apply The function to apply to each item.
+ * @param ctx The context passed to `apply`.
+ */
+void vec_chunked_foreach_ctx(struct vec_chunked const *self,
+                             void (*apply)(void *ctx, vec_item item),
+                             void *ctx);
+
+/**
+ * @brief Applies a function to the items of each chunk at once, in order.
+ *
+ * @param self The vector.
+ * @param apply The function receiving the contiguous items of a chunk.
+ * @param ctx The context passed to `apply`.
+ */
+void vec_chunked_foreach_batch(struct vec_chunked const *self,
+                               void (*apply)(void *ctx, void *items,
+                                             usz count),
+                               void *ctx);
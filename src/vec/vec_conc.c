@@ -0,0 +1,278 @@
+#include "vec_conc.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+#include <stdatomic.h>
+
+#define CVEC_FIRST_SHIFT 6
+#define CVEC_SEGMENTS (sizeof(usz) * 8 - CVEC_FIRST_SHIFT)
+
+_Static_assert(CVEC_FIRST_SEGMENT == 1 << CVEC_FIRST_SHIFT,
+               "CVEC_FIRST_SEGMENT must be 1 << CVEC_FIRST_SHIFT");
+
+/**
+ * @struct cvec
+ * @brief A concurrent vector.
+ *
+ * A segment starts with one ready flag per item, followed by the items. The
+ * counters sit on their own cache lines, as writers hammer `reserved` while
+ * readers advance `published`.
+ */
+struct cvec {
+  atomic_size_t reserved; /**< The indices handed out. */
+  char reserved_pad[VEC_CACHE_LINE - sizeof(atomic_size_t)];
+  atomic_size_t published; /**< A lower bound of the ready prefix. */
+  char published_pad[VEC_CACHE_LINE - sizeof(atomic_size_t)];
+  mut_usz item_size;        /**< The size of an item. */
+  vec_allocator *allocator; /**< The allocator, NULL for malloc. */
+  _Atomic(unsigned char *) segments[CVEC_SEGMENTS]; /**< NULL until used. */
+};
+
+static mut_usz _log2(usz value) {
+#ifdef __GNUC__
+  return sizeof(unsigned long long) * 8 - 1 -
+         (usz)__builtin_clzll((unsigned long long)value);
+#else
+  mut_usz log = 0;
+  for (mut_usz rest = value; rest > 1; rest >>= 1) {
+    log += 1;
+  }
+  return log;
+#endif
+}
+
+/**
+ * @brief Finds the segment of an index and its offset in the segment.
+ *
+ * Segment k holds CVEC_FIRST_SEGMENT << k items starting at index
+ * CVEC_FIRST_SEGMENT * (2^k - 1), so biasing the index by the first
+ * segment's size turns the segment number into a bit position.
+ *
+ * @param index The index.
+ * @param segment Receives the segment.
+ * @param offset Receives the offset in the segment.
+ */
+static void _locate(usz index, mut_usz *segment, mut_usz *offset) {
+  usz biased = index + CVEC_FIRST_SEGMENT;
+  usz top = _log2(biased);
+  *segment = top - CVEC_FIRST_SHIFT;
+  *offset = biased - ((usz)1 << top);
+}
+
+static mut_usz _segment_items(usz segment) {
+  return (usz)CVEC_FIRST_SEGMENT << segment;
+}
+
+/**
+ * @brief Returns the offset of the items in a segment, after the flags.
+ */
+static mut_usz _items_offset(usz segment) {
+  usz align = sizeof(max_align_t);
+  return (_segment_items(segment) + align - 1) / align * align;
+}
+
+static mut_usz _segment_size(struct cvec const *self, usz segment) {
+  usz items = _segment_items(segment);
+  if (self->item_size && items > (USZ_MAX - _items_offset(segment)) /
+                                     self->item_size) {
+    OUT_OF_MEMORY;
+  }
+  return _items_offset(segment) + items * self->item_size;
+}
+
+/**
+ * @brief Returns a segment, installing it if no thread did yet.
+ *
+ * Racing threads each allocate a segment; the first compare-and-swap wins
+ * and the others free theirs.
+ *
+ * @param self The vector.
+ * @param segment The segment number.
+ * @return The segment.
+ */
+static unsigned char *_segment(struct cvec *self, usz segment) {
+  unsigned char *current =
+      atomic_load_explicit(&self->segments[segment], memory_order_acquire);
+  if (current != NULL) {
+    return current;
+  }
+
+  usz size = _segment_size(self, segment);
+  unsigned char *fresh = _vec_allocate(self->allocator, size);
+  memset(fresh, 0, _items_offset(segment));
+  if (atomic_compare_exchange_strong_explicit(
+          &self->segments[segment], &current, fresh, memory_order_acq_rel,
+          memory_order_acquire)) {
+    return fresh;
+  }
+
+  _vec_release(self->allocator, fresh, size);
+  return current;
+}
+
+static atomic_uchar *_flags(unsigned char *segment) {
+  return (atomic_uchar *)(void *)segment;
+}
+
+static unsigned char *_item(struct cvec const *self, unsigned char *segment,
+                            usz segment_index, usz offset) {
+  return segment + _items_offset(segment_index) + offset * self->item_size;
+}
+
+struct cvec *cvec_init(usz item_size) {
+  return cvec_init_with(item_size, NULL);
+}
+
+struct cvec *cvec_init_with(usz item_size, vec_allocator *allocator) {
+  struct cvec *self = _vec_allocate(allocator, sizeof *self);
+  atomic_init(&self->reserved, 0);
+  atomic_init(&self->published, 0);
+  self->item_size = item_size;
+  self->allocator = allocator;
+  for (mut_usz i = 0; i < CVEC_SEGMENTS; ++i) {
+    atomic_init(&self->segments[i], NULL);
+  }
+
+  return self;
+}
+
+void cvec_destroy(struct cvec *self) {
+  if (self == NULL) {
+    return;
+  }
+
+  for (mut_usz i = 0; i < CVEC_SEGMENTS; ++i) {
+    unsigned char *segment =
+        atomic_load_explicit(&self->segments[i], memory_order_acquire);
+    if (segment != NULL) {
+      _vec_release(self->allocator, segment, _segment_size(self, i));
+    }
+  }
+
+  _vec_release(self->allocator, self, sizeof *self);
+}
+
+void cvec_reserve(struct cvec *self, usz capacity) {
+  if (capacity == 0) {
+    return;
+  }
+
+  mut_usz last = 0;
+  mut_usz offset = 0;
+  _locate(capacity - 1, &last, &offset);
+  for (mut_usz i = 0; i <= last; ++i) {
+    _segment(self, i);
+  }
+}
+
+mut_usz cvec_push(struct cvec *self, void const *item) {
+  return cvec_extend(self, item, 1);
+}
+
+mut_usz cvec_extend(struct cvec *self, void const *items, usz count) {
+  usz first =
+      atomic_fetch_add_explicit(&self->reserved, count, memory_order_relaxed);
+  unsigned char const *source = items;
+
+  // copy segment by segment, then flag the copied items as ready
+  for (mut_usz done = 0; done < count;) {
+    mut_usz segment_index = 0;
+    mut_usz offset = 0;
+    _locate(first + done, &segment_index, &offset);
+    unsigned char *segment = _segment(self, segment_index);
+
+    usz room = _segment_items(segment_index) - offset;
+    usz run = count - done < room ? count - done : room;
+    memcpy(_item(self, segment, segment_index, offset),
+           source + done * self->item_size, run * self->item_size);
+
+    atomic_uchar *flags = _flags(segment);
+    for (mut_usz i = 0; i < run; ++i) {
+      atomic_store_explicit(&flags[offset + i], 1, memory_order_release);
+    }
+    done += run;
+  }
+
+  return first;
+}
+
+mut_usz cvec_length(struct cvec const *self) {
+  return atomic_load_explicit(&self->reserved, memory_order_relaxed);
+}
+
+mut_usz cvec_published(struct cvec *self) {
+  usz seen = atomic_load_explicit(&self->published, memory_order_acquire);
+  usz reserved = atomic_load_explicit(&self->reserved, memory_order_acquire);
+
+  mut_usz ready = seen;
+  while (ready < reserved && cvec_at(self, ready) != NULL) {
+    ready += 1;
+  }
+
+  // several readers may advance the prefix at once, keep the largest
+  mut_usz current = seen;
+  while (current < ready && !atomic_compare_exchange_weak_explicit(
+                                &self->published, &current, ready,
+                                memory_order_release, memory_order_relaxed)) {
+  }
+
+  return current > ready ? current : ready;
+}
+
+vec_item cvec_at(struct cvec const *self, usz index) {
+  mut_usz segment_index = 0;
+  mut_usz offset = 0;
+  _locate(index, &segment_index, &offset);
+  if (segment_index >= CVEC_SEGMENTS) {
+    return NULL;
+  }
+
+  unsigned char *segment = atomic_load_explicit(&self->segments[segment_index],
+                                                memory_order_acquire);
+  if (segment == NULL ||
+      !atomic_load_explicit(&_flags(segment)[offset], memory_order_acquire)) {
+    return NULL;
+  }
+
+  return _item(self, segment, segment_index, offset);
+}
+
+bool cvec_get(struct cvec const *self, usz index, void *item) {
+  vec_item found = cvec_at(self, index);
+  if (found == NULL) {
+    return false;
+  }
+
+  memcpy(item, found, self->item_size);
+  return true;
+}
+
+/**
+ * @brief Calls a function without context, passed as the context.
+ *
+ * @param ctx The function.
+ * @param item The item.
+ */
+static void _apply_plain(void *ctx, vec_item item) {
+  void (**apply)(vec_item item) = ctx;
+  (*apply)(item);
+}
+
+void cvec_foreach(struct cvec *self, void (*apply)(vec_item item)) {
+  if (apply == NULL) {
+    return;
+  }
+
+  cvec_foreach_ctx(self, _apply_plain, &apply);
+}
+
+void cvec_foreach_ctx(struct cvec *self,
+                      void (*apply)(void *ctx, vec_item item), void *ctx) {
+  if (apply == NULL) {
+    return;
+  }
+
+  usz length = cvec_published(self);
+  for (mut_usz i = 0; i < length; ++i) {
+    apply(ctx, cvec_at(self, i));
+  }
+}
@@ -0,0 +1,147 @@
+/**
+ * @file vec_conc.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Concurrent vector with lock-free append
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @struct  cvec
+ * @brief A vector any number of threads can append to and read from.
+ *
+ * Items of `item_size` bytes are stored by value in segments that double in
+ * size (CVEC_FIRST_SEGMENT items, then twice as many, ...) and never move, so
+ * item pointers stay valid until the vector is destroyed. A push reserves an
+ * index with one atomic increment, installs the segment if it is the first
+ * to reach it, copies the item in and marks the slot as ready. Readers only
+ * see ready items. Only cvec_destroy must not run concurrently.
+ */
+struct cvec;
+
+/**
+ * @brief Number of items in the first segment, a power of two.
+ */
+#define CVEC_FIRST_SEGMENT 64
+
+/**
+ * @brief Initializes a concurrent vector using malloc.
+ *
+ * @param item_size The size of an item.
+ * @return Returns a new concurrent vector.
+ */
+struct cvec *cvec_init(usz item_size);
+
+/**
+ * @brief Initializes a concurrent vector using a custom allocator.
+ *
+ * The allocator is called from pushing threads and has to be thread-safe.
+ *
+ * @param item_size The size of an item.
+ * @param allocator The allocator for the vector and its segments, NULL for
+ * malloc.
+ * @return Returns a new concurrent vector.
+ */
+struct cvec *cvec_init_with(usz item_size, vec_allocator *allocator);
+
+/**
+ * @brief Frees the vector and its segments.
+ *
+ * @param self The vector.
+ */
+void cvec_destroy(struct cvec *self);
+
+/**
+ * @brief Allocates the segments holding the first `capacity` items.
+ *
+ * Keeps allocations out of later pushes.
+ *
+ * @param self The vector.
+ * @param capacity The number of items.
+ */
+void cvec_reserve(struct cvec *self, usz capacity);
+
+/**
+ * @brief Appends a copy of an item, lock-free.
+ *
+ * @param self The vector.
+ * @param item The address of the item.
+ * @return The index of the item.
+ */
+mut_usz cvec_push(struct cvec *self, void const *item);
+
+/**
+ * @brief Appends copies of consecutive items at consecutive indices.
+ *
+ * The indices are reserved with a single atomic increment; each item becomes
+ * visible as soon as it is copied.
+ *
+ * @param self The vector.
+ * @param items The items.
+ * @param count The number of items.
+ * @return The index of the first item.
+ */
+mut_usz cvec_extend(struct cvec *self, void const *items, usz count);
+
+/**
+ * @brief Get the number of reserved indices, some may not be ready yet.
+ *
+ * @param self The vector.
+ * @return The number of indices handed out by pushes.
+ */
+mut_usz cvec_length(struct cvec const *self);
+
+/**
+ * @brief Get the length of the prefix of ready items.
+ *
+ * Every index below the result can be read with cvec_at.
+ *
+ * @param self The vector.
+ * @return The number of items in the prefix.
+ */
+mut_usz cvec_published(struct cvec *self);
+
+/**
+ * @brief Returns an item if it is ready.
+ *
+ * @param self The vector.
+ * @param index The index of the item.
+ * @return The address of the item, NULL if it was not pushed yet.
+ */
+vec_item cvec_at(struct cvec const *self, usz index);
+
+/**
+ * @brief Copies an item out if it is ready.
+ *
+ * @param self The vector.
+ * @param index The index of the item.
+ * @param item Receives the item.
+ * @return True if the item was ready, false otherwise.
+ */
+bool cvec_get(struct cvec const *self, usz index, void *item);
+
+/**
+ * @brief Applies a function to each item of the ready prefix.
+ *
+ * @param self The vector.
+ * @param apply The function to apply to each item.
+ */
+void cvec_foreach(struct cvec *self, void (*apply)(vec_item item));
+
+/**
+ * @brief Applies a function taking a context to each item of the ready
+ * prefix.
+ *
+ * @param self The vector.
+ * @param apply The function to apply to each item.
+ * @param ctx The context passed to `apply`.
+ */
+void cvec_foreach_ctx(struct cvec *self,
+                      void (*apply)(void *ctx, vec_item item), void *ctx);
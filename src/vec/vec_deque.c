@@ -0,0 +1,216 @@
+#include "vec_deque.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+
+/**
+ * @struct vec_deque
+ * @brief A deque, item i lives in slot (head + i) & (alloc - 1).
+ */
+struct vec_deque {
+  unsigned char *buffer;    /**< The slots. */
+  mut_usz head;             /**< The slot of the front item. */
+  mut_usz length;           /**< The number of items. */
+  mut_usz alloc;            /**< The number of slots, a power of two. */
+  mut_usz item_size;        /**< The size of an item. */
+  vec_allocator *allocator; /**< The allocator, NULL for malloc. */
+};
+
+static unsigned char *_slot_of(struct vec_deque const *self, usz index) {
+  return self->buffer +
+         ((self->head + index) & (self->alloc - 1)) * self->item_size;
+}
+
+/**
+ * @brief Doubles the buffer, unwrapping the items that wrapped around.
+ *
+ * @param self The deque.
+ */
+static void _grow_deque(struct vec_deque *self) {
+  usz old = self->alloc;
+  if (old > USZ_MAX / 2 ||
+      (self->item_size && old * 2 > USZ_MAX / self->item_size)) {
+    OUT_OF_MEMORY;
+  }
+
+  VEC_STAT(_vec_stats_resize(NULL, self->item_size * self->length,
+                             self->item_size * old * 2));
+  self->buffer = _vec_reallocate(self->allocator, self->buffer,
+                                 self->item_size * old,
+                                 self->item_size * old * 2);
+  self->alloc = old * 2;
+
+  // the slots past the old end are free, move the wrapped items there
+  if (self->head + self->length > old) {
+    memcpy(self->buffer + old * self->item_size, self->buffer,
+           (self->head + self->length - old) * self->item_size);
+  }
+}
+
+/**
+ * @brief Moves items towards the front, from the first to the last.
+ *
+ * Slot numbers wrap around, so the runs are cut where either range reaches
+ * the end of the buffer.
+ *
+ * @param self The deque.
+ * @param to The slot of the first item after the move.
+ * @param from The slot of the first item before the move.
+ * @param count The number of items.
+ */
+static void _move_down(struct vec_deque *self, mut_usz to, mut_usz from,
+                       mut_usz count) {
+  usz mask = self->alloc - 1;
+  while (count) {
+    usz source = from & mask;
+    usz target = to & mask;
+    mut_usz run = count;
+    run = run < self->alloc - source ? run : self->alloc - source;
+    run = run < self->alloc - target ? run : self->alloc - target;
+    memmove(self->buffer + target * self->item_size,
+            self->buffer + source * self->item_size, run * self->item_size);
+    from += run;
+    to += run;
+    count -= run;
+  }
+}
+
+/**
+ * @brief Moves items towards the back, from the last to the first.
+ *
+ * @param self The deque.
+ * @param to The slot of the first item after the move.
+ * @param from The slot of the first item before the move.
+ * @param count The number of items.
+ */
+static void _move_up(struct vec_deque *self, usz to, usz from,
+                     mut_usz count) {
+  usz mask = self->alloc - 1;
+  while (count) {
+    usz source_end = ((from + count - 1) & mask) + 1;
+    usz target_end = ((to + count - 1) & mask) + 1;
+    mut_usz run = count;
+    run = run < source_end ? run : source_end;
+    run = run < target_end ? run : target_end;
+    memmove(self->buffer + (target_end - run) * self->item_size,
+            self->buffer + (source_end - run) * self->item_size,
+            run * self->item_size);
+    count -= run;
+  }
+}
+
+struct vec_deque *vec_deque_init(usz item_size) {
+  return vec_deque_init_with(item_size, NULL);
+}
+
+struct vec_deque *vec_deque_init_with(usz item_size, vec_allocator *allocator) {
+  if (item_size && VEC_INITIAL_ALLOC_SIZE > USZ_MAX / item_size) {
+    OUT_OF_MEMORY;
+  }
+
+  struct vec_deque *self = _vec_allocate(allocator, sizeof *self);
+  self->buffer =
+      _vec_allocate(allocator, item_size * VEC_INITIAL_ALLOC_SIZE);
+  self->head = 0;
+  self->length = 0;
+  self->alloc = VEC_INITIAL_ALLOC_SIZE;
+  self->item_size = item_size;
+  self->allocator = allocator;
+  return self;
+}
+
+void vec_deque_destroy(struct vec_deque *self) {
+  if (self == NULL) {
+    return;
+  }
+
+  _vec_release(self->allocator, self->buffer, self->item_size * self->alloc);
+  _vec_release(self->allocator, self, sizeof *self);
+}
+
+mut_usz vec_deque_length(struct vec_deque const *self) {
+  return self->length;
+}
+
+mut_usz vec_deque_capacity(struct vec_deque const *self) {
+  return self->alloc;
+}
+
+void vec_deque_reserve(struct vec_deque *self, usz capacity) {
+  while (self->alloc < capacity) {
+    _grow_deque(self);
+  }
+}
+
+vec_item vec_deque_at(struct vec_deque const *self, usz index) {
+  return index < self->length ? _slot_of(self, index) : NULL;
+}
+
+void vec_deque_push_back(struct vec_deque *self, void const *item) {
+  vec_deque_insert_at(self, self->length, item);
+}
+
+void vec_deque_push_front(struct vec_deque *self, void const *item) {
+  vec_deque_insert_at(self, 0, item);
+}
+
+bool vec_deque_pop_back(struct vec_deque *self, void *item) {
+  return self->length != 0 &&
+         vec_deque_remove_at(self, self->length - 1, item);
+}
+
+bool vec_deque_pop_front(struct vec_deque *self, void *item) {
+  return vec_deque_remove_at(self, 0, item);
+}
+
+bool vec_deque_insert_at(struct vec_deque *self, usz index, void const *item) {
+  if (index > self->length) {
+    return false;
+  }
+
+  if (self->length == self->alloc) {
+    _grow_deque(self);
+  }
+
+  // open the slot by moving whichever side of the index is shorter
+  if (index < self->length - index) {
+    self->head = (self->head - 1) & (self->alloc - 1);
+    _move_down(self, self->head, self->head + 1, index);
+  } else {
+    _move_up(self, self->head + index + 1, self->head + index,
+             self->length - index);
+  }
+
+  memcpy(_slot_of(self, index), item, self->item_size);
+  self->length += 1;
+  VEC_STAT(_vec_stats_push(NULL, 1));
+  return true;
+}
+
+bool vec_deque_remove_at(struct vec_deque *self, usz index, void *item) {
+  if (index >= self->length) {
+    return false;
+  }
+
+  if (item != NULL) {
+    memcpy(item, _slot_of(self, index), self->item_size);
+  }
+
+  // close the slot by moving whichever side of the index is shorter
+  if (index < self->length - 1 - index) {
+    _move_up(self, self->head + 1, self->head, index);
+    self->head = (self->head + 1) & (self->alloc - 1);
+  } else {
+    _move_down(self, self->head + index, self->head + index + 1,
+               self->length - 1 - index);
+  }
+
+  self->length -= 1;
+  return true;
+}
+
+void vec_deque_foreach_ctx(struct vec_deque const *self,
+                           void (*apply)(void *ctx, vec_item item), void *ctx) {
+  for (mut_usz i = 0; i < self->length; ++i) {
+    apply(ctx, _slot_of(self, i));
+  }
+}
@@ -0,0 +1,151 @@
+/**
+ * @file vec_deque.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Double-ended queue with constant time operations at both ends
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @struct  vec_deque
+ * @brief A circular buffer of items stored by value.
+ *
+ * The items start at a head slot and wrap around the end of the buffer, so
+ * pushing and popping at either end moves nothing. The capacity is a power of
+ * two and doubles when the buffer is full. Inserting or removing in the
+ * middle moves the shorter side of the index with at most three memmoves.
+ */
+struct vec_deque;
+
+/**
+ * @brief Initializes a deque using malloc.
+ *
+ * @param item_size The size of an item.
+ * @return Returns a new deque.
+ */
+struct vec_deque *vec_deque_init(usz item_size);
+
+/**
+ * @brief Initializes a deque using a custom allocator.
+ *
+ * @param item_size The size of an item.
+ * @param allocator The allocator for the deque and its buffer, NULL for
+ * malloc.
+ * @return Returns a new deque.
+ */
+struct vec_deque *vec_deque_init_with(usz item_size, vec_allocator *allocator);
+
+/**
+ * @brief Frees a deque and its buffer.
+ *
+ * @param self The deque, may be NULL.
+ */
+void vec_deque_destroy(struct vec_deque *self);
+
+/**
+ * @brief Get the number of items in the deque.
+ *
+ * @param self The deque.
+ * @return The number of items.
+ */
+mut_usz vec_deque_length(struct vec_deque const *self);
+
+/**
+ * @brief Get the number of items the buffer can hold.
+ *
+ * @param self The deque.
+ * @return The capacity.
+ */
+mut_usz vec_deque_capacity(struct vec_deque const *self);
+
+/**
+ * @brief Makes room for at least `capacity` items.
+ *
+ * @param self The deque.
+ * @param capacity The number of items.
+ */
+void vec_deque_reserve(struct vec_deque *self, usz capacity);
+
+/**
+ * @brief Returns the item at an index, counted from the front.
+ *
+ * The address stays valid until the deque is modified.
+ *
+ * @param self The deque.
+ * @param index The index of the item.
+ * @return The address of the item, NULL if the index is invalid.
+ */
+vec_item vec_deque_at(struct vec_deque const *self, usz index);
+
+/**
+ * @brief Adds a copy of an item at the back.
+ *
+ * @param self The deque.
+ * @param item The address of the item.
+ */
+void vec_deque_push_back(struct vec_deque *self, void const *item);
+
+/**
+ * @brief Adds a copy of an item at the front.
+ *
+ * @param self The deque.
+ * @param item The address of the item.
+ */
+void vec_deque_push_front(struct vec_deque *self, void const *item);
+
+/**
+ * @brief Removes the item at the back.
+ *
+ * @param self The deque.
+ * @param item Receives the item, may be NULL.
+ * @return True if an item was removed, false if the deque is empty.
+ */
+bool vec_deque_pop_back(struct vec_deque *self, void *item);
+
+/**
+ * @brief Removes the item at the front.
+ *
+ * @param self The deque.
+ * @param item Receives the item, may be NULL.
+ * @return True if an item was removed, false if the deque is empty.
+ */
+bool vec_deque_pop_front(struct vec_deque *self, void *item);
+
+/**
+ * @brief Inserts a copy of an item before an index.
+ *
+ * An index equal to the length pushes at the back.
+ *
+ * @param self The deque.
+ * @param index The index to insert the item at.
+ * @param item The address of the item.
+ * @return True if the item was inserted, false if the index is invalid.
+ */
+bool vec_deque_insert_at(struct vec_deque *self, usz index, void const *item);
+
+/**
+ * @brief Removes the item at an index.
+ *
+ * @param self The deque.
+ * @param index The index of the item.
+ * @param item Receives the item, may be NULL.
+ * @return True if the item was removed, false if the index is invalid.
+ */
+bool vec_deque_remove_at(struct vec_deque *self, usz index, void *item);
+
+/**
+ * @brief Applies a function taking a context to each item, front to back.
+ *
+ * @param self The deque.
+ * @param apply The function to apply to each item.
+ * @param ctx The context passed to `apply`.
+ */
+void vec_deque_foreach_ctx(struct vec_deque const *self,
+                           void (*apply)(void *ctx, vec_item item), void *ctx);
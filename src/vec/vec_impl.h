@@ -0,0 +1,285 @@
+/**
+ * @file vec_impl.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Internal helpers shared by the vec translation units
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VEC_INITIAL_ALLOC_SIZE 8
+
+/**
+ * @brief Size of a cache line, used to keep shared counters apart.
+ */
+#define VEC_CACHE_LINE 64
+
+#define OUT_OF_MEMORY                                                          \
+  do {                                                                         \
+    fprintf(stderr, "%s:%d - out of memory\n", __FILE__, __LINE__);            \
+    exit(1);                                                                   \
+  } while (0)
+
+/*
+  instrumentation hooks: VEC_STAT(call) runs a _vec_stats_* call when the
+  library is built with VEC_STATS and compiles to nothing otherwise
+*/
+#ifdef VEC_STATS
+#define VEC_STAT(CALL) CALL
+#else
+#define VEC_STAT(CALL) ((void)0)
+#endif
+
+/**
+ * @struct vec
+ * @brief A dynamic array implementation.
+ */
+struct vec {
+  struct vec_interface
+      interface;  /**< Interface for working with vector elements */
+  mut_usz length; /**< The current length of the vector. */
+  mut_usz alloc;  /**< The current allocated size of the vector. */
+  void *elements; /**< Item pointers, or the items themselves in flat mode. */
+  mut_usz stride; /**< Slots between consecutive items, 1 unless a view. */
+  bool owned;     /**< The header was allocated by the vector itself. */
+  bool borrowed;  /**< The items belong to another vector (a view). */
+  bool viewed;    /**< Views may borrow the items, so copies are eager. */
+#ifdef VEC_STATS
+  struct _vec_stats_node *stats; /**< The counters, NULL for views. */
+#endif
+  max_align_t inline_items[VEC_INLINE_SIZE /
+                           sizeof(max_align_t)]; /**< Small buffer used until
+                                                    the items spill. */
+};
+
+_Static_assert(sizeof(struct vec) <= VEC_STORAGE_SIZE,
+               "VEC_STORAGE_SIZE is too small for struct vec");
+
+/**
+ * @brief Returns the size of one slot of the element buffer.
+ *
+ * @param self The vector.
+ * @return The item size in flat mode, the size of a pointer otherwise.
+ */
+static inline mut_usz _slot_size(vec self) {
+  return self->interface.flat ? self->interface.item_size : sizeof(vec_item);
+}
+
+/**
+ * @brief Returns the address of a slot of the element buffer.
+ *
+ * @param self The vector.
+ * @param index The index of the slot.
+ * @return The address of the slot.
+ */
+static inline char *_slot(vec self, usz index) {
+  return (char *)self->elements + index * self->stride * _slot_size(self);
+}
+
+/**
+ * @brief Returns the item stored at an index.
+ *
+ * @param self The vector.
+ * @param index The index of the item.
+ * @return The item pointer, pointing into the buffer in flat mode.
+ */
+static inline vec_item _at(vec self, usz index) {
+  char *slot = _slot(self, index);
+  return self->interface.flat ? (vec_item)slot : *(vec_item *)(void *)slot;
+}
+
+/**
+ * @brief Stores an item into a slot of the element buffer.
+ *
+ * @param self The vector.
+ * @param index The index of the slot.
+ * @param item The item to store, copied by value in flat mode.
+ */
+static inline void _store(mut_vec self, usz index, vec_item item) {
+  char *slot = _slot(self, index);
+  if (self->interface.flat) {
+    memcpy(slot, item, self->interface.item_size);
+  } else {
+    *(vec_item *)(void *)slot = item;
+  }
+}
+
+/**
+ * @brief Swaps two non-overlapping blocks of memory.
+ *
+ * @param a The first block.
+ * @param b The second block.
+ * @param size The size of the blocks.
+ */
+static inline void _swap_bytes(void *a, void *b, usz size) {
+  unsigned char tmp[64];
+  unsigned char *x = a;
+  unsigned char *y = b;
+  for (mut_usz done = 0; done < size; done += sizeof tmp) {
+    usz chunk = size - done < sizeof tmp ? size - done : sizeof tmp;
+    memcpy(tmp, x + done, chunk);
+    memcpy(x + done, y + done, chunk);
+    memcpy(y + done, tmp, chunk);
+  }
+}
+
+/**
+ * @brief Allocates memory through an allocator, exits when out of memory.
+ *
+ * @param allocator The allocator, NULL for malloc.
+ * @param size The size of the block.
+ * @return The allocated block.
+ */
+void *_vec_allocate(vec_allocator *allocator, usz size);
+
+/**
+ * @brief Resizes memory through an allocator, exits when out of memory.
+ *
+ * @param allocator The allocator, NULL for realloc.
+ * @param ptr The block to resize.
+ * @param old_size The current size of the block.
+ * @param new_size The requested size of the block.
+ * @return The resized block.
+ */
+void *_vec_reallocate(vec_allocator *allocator, void *ptr, usz old_size,
+                      usz new_size);
+
+/**
+ * @brief Frees memory through an allocator.
+ *
+ * @param allocator The allocator, NULL for free.
+ * @param ptr The block to free.
+ * @param size The size of the block.
+ */
+void _vec_release(vec_allocator *allocator, void *ptr, usz size);
+
+/**
+ * @brief Gives the vector its own buffer before it is modified.
+ *
+ * Items are copied by value in flat mode, otherwise each item is copied into
+ * a new allocation, as the old ones stay owned by the other copies.
+ *
+ * @param self The vector.
+ */
+void _vec_unshare(mut_vec self);
+
+/**
+ * @brief Gives a vector its own buffer before its items are modified in
+ * place by a function taking a `vec`, such as vec_foreach.
+ *
+ * Views borrow the buffer of another vector and are left alone.
+ *
+ * @param self The vector.
+ */
+static inline void _vec_unshare_items(vec self) {
+  if (!self->borrowed) {
+    // only the buffer is shared, the header itself is never read-only
+    _vec_unshare((mut_vec)(uptr)self);
+  }
+}
+
+/**
+ * @brief Copies an item into a new allocation of the vector's allocator.
+ *
+ * Used to give pointer mode vectors their own copy of another vector's item.
+ *
+ * @param self The vector receiving the copy.
+ * @param item The item to copy.
+ * @return The new item.
+ */
+vec_item _vec_clone_item(vec self, vec_item item);
+
+/**
+ * @brief Allocate callback of allocators that only manage the block of one
+ * svec, such as a file mapping or a buffer used in place.
+ *
+ * Falls back to malloc, but such allocators release nothing else than their
+ * own block, so containers derived from the svec must not inherit them.
+ *
+ * @param ctx Unused.
+ * @param size The size of the block.
+ * @return The allocated block.
+ */
+void *_svec_block_allocate(void *ctx, usz size);
+
+/**
+ * @brief Returns the allocator of a new container derived from an svec.
+ *
+ * @param svec_ptr The svec.
+ * @return The allocator of the svec, NULL for malloc when the allocator only
+ * manages the block of the svec.
+ */
+vec_allocator *_svec_derived_allocator(void const *svec_ptr);
+
+/**
+ * @brief Deep copies a range of a vector into a new vector.
+ *
+ * @param self The vector.
+ * @param first_index The index of the first element to copy.
+ * @param second_index The index past the last element to copy.
+ * @return Returns a new vector.
+ */
+mut_vec _vec_copy_range(vec self, usz first_index, usz second_index);
+
+#ifdef VEC_STATS
+/**
+ * @brief Gives a new vector its counters and registers it as live.
+ *
+ * @param self The vector.
+ */
+void _vec_stats_track(mut_vec self);
+
+/**
+ * @brief Unregisters a vector and frees its counters.
+ *
+ * @param self The vector.
+ */
+void _vec_stats_untrack(mut_vec self);
+
+/**
+ * @brief Counts pushed items.
+ *
+ * @param self The vector, NULL for svecs.
+ * @param count The number of items.
+ */
+void _vec_stats_push(vec self, usz count);
+
+/**
+ * @brief Counts a resize of an element buffer.
+ *
+ * @param self The vector, NULL for svecs and typed vectors.
+ * @param moved The bytes of items carried over.
+ * @param capacity The new size of the buffer in bytes.
+ */
+void _vec_stats_resize(vec self, usz moved, usz capacity);
+
+/**
+ * @brief Counts a copy, slice or map of a vector.
+ *
+ * @param self The copied vector.
+ */
+void _vec_stats_copy(vec self);
+
+/**
+ * @brief Counts a shared buffer duplicated before a write.
+ *
+ * @param self The written vector.
+ */
+void _vec_stats_unshare(vec self);
+
+/**
+ * @brief Counts an item allocated by a copy in pointer mode.
+ *
+ * @param self The vector the item is copied from or for.
+ */
+void _vec_stats_item_copy(vec self);
+#endif
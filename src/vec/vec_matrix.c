@@ -0,0 +1,361 @@
+#include "vec_matrix.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+
+static mut_usz _lines(struct vec_matrix const *self) {
+  return self->order == VEC_ROW_MAJOR ? self->rows : self->cols;
+}
+
+static mut_usz _line_length(struct vec_matrix const *self) {
+  return self->order == VEC_ROW_MAJOR ? self->cols : self->rows;
+}
+
+static unsigned char *_line(struct vec_matrix const *self, usz line) {
+  return (unsigned char *)self->data + line * self->stride * self->item_size;
+}
+
+/**
+ * @brief Returns an element without checking the row and the column.
+ */
+static unsigned char *_element(struct vec_matrix const *self, usz row,
+                               usz col) {
+  return self->order == VEC_ROW_MAJOR
+             ? _line(self, row) + col * self->item_size
+             : _line(self, col) + row * self->item_size;
+}
+
+static bool _same_shape(struct vec_matrix const *a,
+                        struct vec_matrix const *b, usz item_size) {
+  return a->rows == b->rows && a->cols == b->cols &&
+         a->item_size == item_size && b->item_size == item_size;
+}
+
+struct vec_matrix vec_matrix_init(usz item_size, usz rows, usz cols,
+                                  enum vec_matrix_order order) {
+  return vec_matrix_init_with(item_size, rows, cols, order, NULL);
+}
+
+struct vec_matrix vec_matrix_init_with(usz item_size, usz rows, usz cols,
+                                       enum vec_matrix_order order,
+                                       vec_allocator *allocator) {
+  struct vec_matrix self = {
+      .rows = rows,
+      .cols = cols,
+      .item_size = item_size,
+      .order = order,
+      .allocator = allocator,
+  };
+
+  usz lines = _lines(&self);
+  mut_usz length = _line_length(&self);
+  if (item_size && length > (USZ_MAX - VEC_MATRIX_ALIGN) / item_size) {
+    OUT_OF_MEMORY;
+  }
+
+  // pad lines to whole aligned blocks when elements tile them exactly
+  if (item_size && VEC_MATRIX_ALIGN % item_size == 0) {
+    length = (length * item_size + VEC_MATRIX_ALIGN - 1) /
+             VEC_MATRIX_ALIGN * (VEC_MATRIX_ALIGN / item_size);
+  }
+  self.stride = length;
+
+  usz line_size = length * item_size;
+  if (line_size && lines > (USZ_MAX - VEC_MATRIX_ALIGN) / line_size) {
+    OUT_OF_MEMORY;
+  }
+
+  self.block_size = lines * line_size + VEC_MATRIX_ALIGN - 1;
+  self.block = _vec_allocate(allocator, self.block_size);
+  memset(self.block, 0, self.block_size);
+  self.data = (void *)(((uptr)self.block + VEC_MATRIX_ALIGN - 1) &
+                       ~(uptr)(VEC_MATRIX_ALIGN - 1));
+  return self;
+}
+
+void vec_matrix_destroy(struct vec_matrix *self) {
+  if (self->block == NULL) {
+    return;
+  }
+
+  _vec_release(self->allocator, self->block, self->block_size);
+  self->block = NULL;
+  self->data = NULL;
+}
+
+vec_item vec_matrix_at(struct vec_matrix const *self, usz row, usz col) {
+  if (row >= self->rows || col >= self->cols) {
+    return NULL;
+  }
+
+  return _element(self, row, col);
+}
+
+bool vec_matrix_view(struct vec_matrix *view, struct vec_matrix const *self,
+                     usz row, usz col, usz rows, usz cols) {
+  if (row > self->rows || rows > self->rows - row || col > self->cols ||
+      cols > self->cols - col) {
+    return false;
+  }
+
+  *view = *self;
+  view->rows = rows;
+  view->cols = cols;
+  view->block = NULL;
+  view->block_size = 0;
+  if (row < self->rows && col < self->cols) {
+    view->data = _element(self, row, col);
+  }
+
+  return true;
+}
+
+bool vec_matrix_row_view(struct vec_matrix *view,
+                         struct vec_matrix const *self, usz row) {
+  return row < self->rows && vec_matrix_view(view, self, row, 0, 1, self->cols);
+}
+
+bool vec_matrix_col_view(struct vec_matrix *view,
+                         struct vec_matrix const *self, usz col) {
+  return col < self->cols && vec_matrix_view(view, self, 0, col, self->rows, 1);
+}
+
+void vec_matrix_transposed(struct vec_matrix *view,
+                           struct vec_matrix const *self) {
+  *view = *self;
+  view->rows = self->cols;
+  view->cols = self->rows;
+  view->order =
+      self->order == VEC_ROW_MAJOR ? VEC_COL_MAJOR : VEC_ROW_MAJOR;
+  view->block = NULL;
+  view->block_size = 0;
+}
+
+/*
+  copies between opposite orders: element e of line l of dst is element l
+  of line e of src, so one side is always read or written with a stride.
+  Walking tiles keeps the strided lines of a tile in cache.
+*/
+
+#define TILE_COPY(T)                                                           \
+  for (mut_usz l0 = 0; l0 < lines; l0 += VEC_MATRIX_TILE) {                    \
+    usz l1 = lines - l0 < VEC_MATRIX_TILE ? lines : l0 + VEC_MATRIX_TILE;      \
+    for (mut_usz e0 = 0; e0 < length; e0 += VEC_MATRIX_TILE) {                 \
+      usz e1 = length - e0 < VEC_MATRIX_TILE ? length : e0 + VEC_MATRIX_TILE;  \
+      for (mut_usz l = l0; l < l1; ++l) {                                      \
+        T *to = (T *)(void *)_line(dst, l);                                    \
+        for (mut_usz e = e0; e < e1; ++e) {                                    \
+          to[e] = ((T *)(void *)_line(src, e))[l];                             \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  }
+
+static void _tile_copy(struct vec_matrix *dst, struct vec_matrix const *src) {
+  usz lines = _lines(dst);
+  usz length = _line_length(dst);
+  switch (dst->item_size) {
+  case 1:
+    TILE_COPY(mut_u8);
+    return;
+  case 2:
+    TILE_COPY(mut_u16);
+    return;
+  case 4:
+    TILE_COPY(mut_u32);
+    return;
+  case 8:
+    TILE_COPY(mut_u64);
+    return;
+  default:
+    break;
+  }
+
+  usz size = dst->item_size;
+  for (mut_usz l0 = 0; l0 < lines; l0 += VEC_MATRIX_TILE) {
+    usz l1 = lines - l0 < VEC_MATRIX_TILE ? lines : l0 + VEC_MATRIX_TILE;
+    for (mut_usz e0 = 0; e0 < length; e0 += VEC_MATRIX_TILE) {
+      usz e1 = length - e0 < VEC_MATRIX_TILE ? length : e0 + VEC_MATRIX_TILE;
+      for (mut_usz l = l0; l < l1; ++l) {
+        for (mut_usz e = e0; e < e1; ++e) {
+          memcpy(_line(dst, l) + e * size, _line(src, e) + l * size, size);
+        }
+      }
+    }
+  }
+}
+
+bool vec_matrix_copy(struct vec_matrix *dst, struct vec_matrix const *src) {
+  if (!_same_shape(dst, src, src->item_size)) {
+    return false;
+  }
+
+  if (dst->order != src->order) {
+    _tile_copy(dst, src);
+    return true;
+  }
+
+  usz lines = _lines(dst);
+  usz size = _line_length(dst) * dst->item_size;
+  for (mut_usz l = 0; l < lines && size != 0; ++l) {
+    memcpy(_line(dst, l), _line(src, l), size);
+  }
+
+  return true;
+}
+
+bool vec_matrix_transpose(struct vec_matrix *dst,
+                          struct vec_matrix const *src) {
+  struct vec_matrix view;
+  vec_matrix_transposed(&view, src);
+  return vec_matrix_copy(dst, &view);
+}
+
+void vec_matrix_foreach_ctx(struct vec_matrix const *self,
+                            void (*apply)(void *ctx, vec_item item),
+                            void *ctx) {
+  usz lines = _lines(self);
+  usz length = _line_length(self);
+  for (mut_usz l = 0; l < lines; ++l) {
+    unsigned char *line = _line(self, l);
+    for (mut_usz e = 0; e < length; ++e) {
+      apply(ctx, line + e * self->item_size);
+    }
+  }
+}
+
+void vec_matrix_foreach_batch(struct vec_matrix const *self,
+                              void (*apply)(void *ctx, void *items,
+                                            usz count),
+                              void *ctx) {
+  usz lines = _lines(self);
+  for (mut_usz l = 0; l < lines; ++l) {
+    apply(ctx, _line(self, l), _line_length(self));
+  }
+}
+
+/*
+  typed operations: when the orders match, each line is handed to a kernel
+  of vec_simd.c, otherwise the kernels run one element at a time so that
+  integer arithmetic still wraps the same way. Products run on row-major
+  dst and b, adding scaled rows of b to rows of dst over tiles of rows and
+  columns that stay in cache.
+*/
+
+#define MATRIX_BINARY(T, OP)                                                   \
+  bool vec_matrix_##OP##_##T(struct vec_matrix *dst,                           \
+                             struct vec_matrix const *a,                       \
+                             struct vec_matrix const *b) {                     \
+    if (!_same_shape(dst, a, sizeof(T)) || !_same_shape(dst, b, sizeof(T))) {  \
+      return false;                                                            \
+    }                                                                          \
+                                                                               \
+    if (dst->order == a->order && dst->order == b->order) {                    \
+      usz lines = _lines(dst);                                                 \
+      for (mut_usz l = 0; l < lines; ++l) {                                    \
+        vec_simd_##OP##_##T((void *)_line(dst, l), (void *)_line(a, l),        \
+                            (void *)_line(b, l), _line_length(dst));           \
+      }                                                                        \
+      return true;                                                             \
+    }                                                                          \
+                                                                               \
+    for (mut_usz i = 0; i < dst->rows; ++i) {                                  \
+      for (mut_usz j = 0; j < dst->cols; ++j) {                                \
+        vec_simd_##OP##_##T((void *)_element(dst, i, j),                       \
+                            (void *)_element(a, i, j),                         \
+                            (void *)_element(b, i, j), 1);                     \
+      }                                                                        \
+    }                                                                          \
+    return true;                                                               \
+  }
+
+#define MATRIX_DEFINE(T, ACC)                                                  \
+  MATRIX_BINARY(T, add)                                                        \
+  MATRIX_BINARY(T, mul)                                                        \
+                                                                               \
+  bool vec_matrix_scale_##T(struct vec_matrix *dst,                            \
+                            struct vec_matrix const *a, T k) {                 \
+    if (!_same_shape(dst, a, sizeof(T))) {                                     \
+      return false;                                                            \
+    }                                                                          \
+                                                                               \
+    if (dst->order == a->order) {                                              \
+      usz lines = _lines(dst);                                                 \
+      for (mut_usz l = 0; l < lines; ++l) {                                    \
+        vec_simd_scale_##T((void *)_line(dst, l), (void *)_line(a, l), k,      \
+                           _line_length(dst));                                 \
+      }                                                                        \
+      return true;                                                             \
+    }                                                                          \
+                                                                               \
+    for (mut_usz i = 0; i < dst->rows; ++i) {                                  \
+      for (mut_usz j = 0; j < dst->cols; ++j) {                                \
+        vec_simd_scale_##T((void *)_element(dst, i, j),                        \
+                           (void *)_element(a, i, j), k, 1);                   \
+      }                                                                        \
+    }                                                                          \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  static void _matmul_##T(struct vec_matrix *dst, struct vec_matrix const *a,  \
+                          struct vec_matrix const *b) {                        \
+    usz rows = dst->rows;                                                      \
+    usz cols = dst->cols;                                                      \
+    usz inner = a->cols;                                                       \
+    for (mut_usz i = 0; i < rows && cols != 0; ++i) {                          \
+      memset(_line(dst, i), 0, cols * sizeof(T));                              \
+    }                                                                          \
+                                                                               \
+    for (mut_usz i0 = 0; i0 < rows; i0 += VEC_MATRIX_TILE) {                   \
+      usz i1 = rows - i0 < VEC_MATRIX_TILE ? rows : i0 + VEC_MATRIX_TILE;      \
+      for (mut_usz k0 = 0; k0 < inner; k0 += VEC_MATRIX_TILE) {                \
+        usz k1 = inner - k0 < VEC_MATRIX_TILE ? inner : k0 + VEC_MATRIX_TILE;  \
+        for (mut_usz j0 = 0; j0 < cols; j0 += VEC_MATRIX_TILE) {               \
+          usz width =                                                          \
+              cols - j0 < VEC_MATRIX_TILE ? cols - j0 : VEC_MATRIX_TILE;       \
+          for (mut_usz i = i0; i < i1; ++i) {                                  \
+            mut_##T *out = (mut_##T *)(void *)_line(dst, i) + j0;              \
+            for (mut_usz k = k0; k < k1; ++k) {                                \
+              vec_simd_axpy_##T(out, (T *)(void *)_line(b, k) + j0,            \
+                                *(T *)(void *)_element(a, i, k), width);       \
+            }                                                                  \
+          }                                                                    \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  bool vec_matrix_matmul_##T(struct vec_matrix *dst,                           \
+                             struct vec_matrix const *a,                       \
+                             struct vec_matrix const *b) {                     \
+    if (a->item_size != sizeof(T) || b->item_size != sizeof(T) ||              \
+        dst->item_size != sizeof(T) || a->cols != b->rows ||                   \
+        dst->rows != a->rows || dst->cols != b->cols) {                        \
+      return false;                                                            \
+    }                                                                          \
+                                                                               \
+    struct vec_matrix rows_b = *b;                                             \
+    if (b->order != VEC_ROW_MAJOR) {                                           \
+      rows_b = vec_matrix_init_with(sizeof(T), b->rows, b->cols,               \
+                                    VEC_ROW_MAJOR, b->allocator);              \
+      vec_matrix_copy(&rows_b, b);                                             \
+    }                                                                          \
+                                                                               \
+    struct vec_matrix rows_dst = *dst;                                         \
+    if (dst->order != VEC_ROW_MAJOR) {                                         \
+      rows_dst = vec_matrix_init_with(sizeof(T), dst->rows, dst->cols,         \
+                                      VEC_ROW_MAJOR, dst->allocator);          \
+    }                                                                          \
+                                                                               \
+    _matmul_##T(&rows_dst, a, &rows_b);                                        \
+                                                                               \
+    if (dst->order != VEC_ROW_MAJOR) {                                         \
+      vec_matrix_copy(dst, &rows_dst);                                         \
+      vec_matrix_destroy(&rows_dst);                                           \
+    }                                                                          \
+    if (b->order != VEC_ROW_MAJOR) {                                           \
+      vec_matrix_destroy(&rows_b);                                             \
+    }                                                                          \
+    return true;                                                               \
+  }
+
+VEC_SIMD_TYPES(MATRIX_DEFINE)
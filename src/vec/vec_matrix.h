@@ -0,0 +1,234 @@
+/**
+ * @file vec_matrix.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Dense two-dimensional matrix in one contiguous block
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "vec_simd.h"
+#include "wtfc.h"
+
+/**
+ * @enum  vec_matrix_order
+ * @brief Layout of the elements of a matrix.
+ */
+enum vec_matrix_order {
+  VEC_ROW_MAJOR, /**< The elements of a row are contiguous. */
+  VEC_COL_MAJOR, /**< The elements of a column are contiguous. */
+};
+
+/**
+ * @brief Alignment of the block and of each line of an owned matrix.
+ */
+#define VEC_MATRIX_ALIGN 64
+
+/**
+ * @brief Side of the tiles walked by transposes and matrix products.
+ */
+#define VEC_MATRIX_TILE 64
+
+/**
+ * @struct  vec_matrix
+ * @brief A matrix of fixed-size elements stored in one block.
+ *
+ * A line is a row in row-major order and a column in column-major order.
+ * Lines are contiguous and `stride` elements apart, and owned matrices pad
+ * each line to VEC_MATRIX_ALIGN bytes when the element size divides it, so
+ * every line starts aligned for the vectorized kernels. Views share the
+ * elements of another matrix and are plain values that need no destroy.
+ */
+struct vec_matrix {
+  void *data;                  /**< The element at row 0, column 0. */
+  mut_usz rows;                /**< The number of rows. */
+  mut_usz cols;                /**< The number of columns. */
+  mut_usz stride;              /**< The elements between two lines. */
+  mut_usz item_size;           /**< The size of an element. */
+  enum vec_matrix_order order; /**< The layout of the elements. */
+  void *block;                 /**< The owned block, NULL for views. */
+  mut_usz block_size;          /**< The size of the owned block. */
+  vec_allocator *allocator;    /**< The allocator, NULL for malloc. */
+};
+
+/**
+ * @brief Initializes a zeroed matrix using malloc.
+ *
+ * @param item_size The size of an element.
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @param order The layout of the elements.
+ * @return Returns a new matrix.
+ */
+struct vec_matrix vec_matrix_init(usz item_size, usz rows, usz cols,
+                                  enum vec_matrix_order order);
+
+/**
+ * @brief Initializes a zeroed matrix using a custom allocator.
+ *
+ * @param item_size The size of an element.
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @param order The layout of the elements.
+ * @param allocator The allocator, NULL for malloc.
+ * @return Returns a new matrix.
+ */
+struct vec_matrix vec_matrix_init_with(usz item_size, usz rows, usz cols,
+                                       enum vec_matrix_order order,
+                                       vec_allocator *allocator);
+
+/**
+ * @brief Macro for initializing a zeroed row-major matrix of a type.
+ */
+#define vec_matrix_new(TYPE, ROWS, COLS)                                       \
+  vec_matrix_init(sizeof(TYPE), (ROWS), (COLS), VEC_ROW_MAJOR)
+
+/**
+ * @brief Frees the block of a matrix, does nothing for views.
+ *
+ * @param self The matrix.
+ */
+void vec_matrix_destroy(struct vec_matrix *self);
+
+/**
+ * @brief Returns the element at a row and a column.
+ *
+ * @param self The matrix.
+ * @param row The row.
+ * @param col The column.
+ * @return The address of the element, NULL if out of range.
+ */
+vec_item vec_matrix_at(struct vec_matrix const *self, usz row, usz col);
+
+/**
+ * @brief Macro for accessing an element of a matrix as a type.
+ */
+#define vec_matrix_get(TYPE, M, ROW, COL)                                      \
+  (*(TYPE *)vec_matrix_at((M), (ROW), (COL)))
+
+/**
+ * @brief Makes a view of a rectangle of a matrix.
+ *
+ * @param view Receives the view.
+ * @param self The matrix.
+ * @param row The first row of the rectangle.
+ * @param col The first column of the rectangle.
+ * @param rows The number of rows of the rectangle.
+ * @param cols The number of columns of the rectangle.
+ * @return True if the rectangle fits in the matrix, false otherwise.
+ */
+bool vec_matrix_view(struct vec_matrix *view, struct vec_matrix const *self,
+                     usz row, usz col, usz rows, usz cols);
+
+/**
+ * @brief Makes a view of a row of a matrix.
+ *
+ * @param view Receives the 1 x cols view.
+ * @param self The matrix.
+ * @param row The row.
+ * @return True if the row exists, false otherwise.
+ */
+bool vec_matrix_row_view(struct vec_matrix *view,
+                         struct vec_matrix const *self, usz row);
+
+/**
+ * @brief Makes a view of a column of a matrix.
+ *
+ * @param view Receives the rows x 1 view.
+ * @param self The matrix.
+ * @param col The column.
+ * @return True if the column exists, false otherwise.
+ */
+bool vec_matrix_col_view(struct vec_matrix *view,
+                         struct vec_matrix const *self, usz col);
+
+/**
+ * @brief Makes a view of the transpose of a matrix without moving elements.
+ *
+ * The view has the opposite order, so its lines are those of the matrix.
+ *
+ * @param view Receives the view.
+ * @param self The matrix.
+ */
+void vec_matrix_transposed(struct vec_matrix *view,
+                           struct vec_matrix const *self);
+
+/**
+ * @brief Copies the elements of a matrix into another of the same shape.
+ *
+ * Lines are copied with memcpy when the orders match, otherwise elements
+ * are moved tile by tile. The matrices must not overlap.
+ *
+ * @param dst The destination.
+ * @param src The source.
+ * @return True if the shapes and element sizes match, false otherwise.
+ */
+bool vec_matrix_copy(struct vec_matrix *dst, struct vec_matrix const *src);
+
+/**
+ * @brief Writes the transpose of a matrix, tile by tile.
+ *
+ * The matrices must not overlap.
+ *
+ * @param dst The destination, with as many rows as `src` has columns.
+ * @param src The source.
+ * @return True if the shapes and element sizes match, false otherwise.
+ */
+bool vec_matrix_transpose(struct vec_matrix *dst,
+                          struct vec_matrix const *src);
+
+/**
+ * @brief Applies a function taking a context to each element, in memory
+ * order.
+ *
+ * @param self The matrix.
+ * @param apply The function to apply to each element.
+ * @param ctx The context passed to `apply`.
+ */
+void vec_matrix_foreach_ctx(struct vec_matrix const *self,
+                            void (*apply)(void *ctx, vec_item item),
+                            void *ctx);
+
+/**
+ * @brief Applies a function to the elements of each line at once.
+ *
+ * @param self The matrix.
+ * @param apply The function receiving the contiguous elements of a line.
+ * @param ctx The context passed to `apply`.
+ */
+void vec_matrix_foreach_batch(struct vec_matrix const *self,
+                              void (*apply)(void *ctx, void *items,
+                                            usz count),
+                              void *ctx);
+
+/*
+  operations, for each kernel type T of vec_simd.h, returning false when
+  the shapes or element sizes do not match:
+
+  vec_matrix_add_T(dst, a, b)    dst = a + b, elementwise
+  vec_matrix_mul_T(dst, a, b)    dst = a * b, elementwise
+  vec_matrix_scale_T(dst, a, k)  dst = a * k
+  vec_matrix_matmul_T(dst, a, b) dst = a b, the matrix product
+
+  elementwise operations run the kernels once per line when all matrices
+  share an order, dst may then alias a or b. The product must not overlap
+  its operands and works on row-major copies of dst and b when they are
+  column-major.
+*/
+
+#define VEC_MATRIX_DECLARE(T, ACC)                                             \
+  bool vec_matrix_add_##T(struct vec_matrix *dst, struct vec_matrix const *a,  \
+                          struct vec_matrix const *b);                         \
+  bool vec_matrix_mul_##T(struct vec_matrix *dst, struct vec_matrix const *a,  \
+                          struct vec_matrix const *b);                         \
+  bool vec_matrix_scale_##T(struct vec_matrix *dst,                            \
+                            struct vec_matrix const *a, T k);                  \
+  bool vec_matrix_matmul_##T(struct vec_matrix *dst,                           \
+                             struct vec_matrix const *a,                       \
+                             struct vec_matrix const *b);
+
+VEC_SIMD_TYPES(VEC_MATRIX_DECLARE)
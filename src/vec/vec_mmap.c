@@ -0,0 +1,244 @@
+#define _GNU_SOURCE
+#include "vec_mmap.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @union _svec_preamble
+ * @brief The start of a file holding an svec, in front of the svec block.
+ *
+ * Padded so that the items behind `struct _svec_mdi` stay aligned.
+ */
+union _svec_preamble {
+  struct {
+    char magic[8];     /**< SVEC_MMAP_MAGIC. */
+    mut_u32 version;   /**< SVEC_MMAP_VERSION. */
+    mut_u32 word_size; /**< The size of usz when the file was written. */
+  } fields;            /**< The fields. */
+  unsigned char pad[VEC_CACHE_LINE]; /**< Keeps the block aligned. */
+};
+
+/**
+ * @brief Identifies files holding an svec.
+ */
+static char const SVEC_MMAP_MAGIC[8] = {'v', 'e', 'c', ' ',
+                                        's', 'v', 'e', 'c'};
+
+/**
+ * @struct _svec_mmap
+ * @brief The mapping of a file-backed svec, the context of its allocator.
+ */
+struct _svec_mmap {
+  struct vec_allocator allocator; /**< Handed to the svec, ctx is self. */
+  unsigned char *base;            /**< The start of the mapping. */
+  mut_usz mapped;                 /**< The size of the mapping and file. */
+  int fd;                         /**< The file. */
+};
+
+static struct _svec_mdi *_block(struct _svec_mmap *map) {
+  return (struct _svec_mdi *)(void *)(map->base +
+                                      sizeof(union _svec_preamble));
+}
+
+/**
+ * @brief Resizes the file and its mapping to hold a block of `new_size`.
+ *
+ * @param ctx The mapping.
+ * @param ptr The block, always the one in the mapping.
+ * @param old_size The current size of the block.
+ * @param new_size The requested size of the block.
+ * @return The block, which moves when the mapping moves, NULL on error.
+ */
+static void *_mmap_reallocate(void *ctx, void *ptr, usz old_size,
+                              usz new_size) {
+  struct _svec_mmap *map = ctx;
+  (void)ptr;
+  (void)old_size;
+
+  usz total = sizeof(union _svec_preamble) + new_size;
+  if (ftruncate(map->fd, (off_t)total) != 0) {
+    return NULL;
+  }
+
+#ifdef MREMAP_MAYMOVE
+  void *base = mremap(map->base, map->mapped, total, MREMAP_MAYMOVE);
+#else
+  munmap(map->base, map->mapped);
+  void *base =
+      mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, map->fd, 0);
+#endif
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+
+  map->base = base;
+  map->mapped = total;
+  return _block(map);
+}
+
+/**
+ * @brief Unmaps and closes the file, leaving its contents as they are.
+ */
+static void _unmap(struct _svec_mmap *map) {
+  munmap(map->base, map->mapped);
+  close(map->fd);
+  free(map);
+}
+
+/**
+ * @brief Unmaps and closes the file, the changes stay in it.
+ *
+ * The allocator pointer is process-local and cleared first, so a closed file
+ * keeps no stale address.
+ */
+static void _mmap_release(void *ctx, void *ptr, usz size) {
+  struct _svec_mmap *map = ctx;
+  (void)ptr;
+  (void)size;
+
+  _block(map)->allocator = NULL;
+  _unmap(map);
+}
+
+/**
+ * @brief Maps a whole file.
+ *
+ * @param fd The file.
+ * @param total The size of the file.
+ * @return The mapping, NULL if the file could not be mapped.
+ */
+static struct _svec_mmap *_map(int fd, usz total) {
+  void *base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+
+  struct _svec_mmap *map = malloc(sizeof *map);
+  if (map == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  map->allocator = (struct vec_allocator){
+      .allocate = _svec_block_allocate,
+      .reallocate = _mmap_reallocate,
+      .release = _mmap_release,
+      .ctx = map,
+  };
+  map->base = base;
+  map->mapped = total;
+  map->fd = fd;
+  return map;
+}
+
+/**
+ * @brief Returns the mapping of an svec, NULL if it is not file-backed.
+ */
+static struct _svec_mmap *_mapping(void const *svec_ptr) {
+  struct _svec_mdi const *data = svec_ptr;
+  if (data->allocator == NULL ||
+      data->allocator->reallocate != _mmap_reallocate) {
+    return NULL;
+  }
+
+  return data->allocator->ctx;
+}
+
+void *_svec_create_mmap(char const *path, usz size, usz capacity) {
+  usz header = sizeof(union _svec_preamble) + sizeof(struct _svec_mdi);
+  if (size && capacity > (USZ_MAX - header) / size) {
+    OUT_OF_MEMORY;
+  }
+
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  usz total = header + size * capacity;
+  struct _svec_mmap *map = NULL;
+  if (ftruncate(fd, (off_t)total) != 0 || (map = _map(fd, total)) == NULL) {
+    close(fd);
+    return NULL;
+  }
+
+  union _svec_preamble *preamble = (void *)map->base;
+  memcpy(preamble->fields.magic, SVEC_MMAP_MAGIC, sizeof SVEC_MMAP_MAGIC);
+  preamble->fields.version = SVEC_MMAP_VERSION;
+  preamble->fields.word_size = sizeof(usz);
+
+  struct _svec_mdi *data = _block(map);
+  data->length = 0;
+  data->alloc = capacity;
+  data->type_size = size;
+  data->allocator = &map->allocator;
+  return data;
+}
+
+void *_svec_open_mmap(char const *path, usz size) {
+  usz header = sizeof(union _svec_preamble) + sizeof(struct _svec_mdi);
+  int fd = open(path, O_RDWR);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat st;
+  struct _svec_mmap *map = NULL;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)header ||
+      (map = _map(fd, (usz)st.st_size)) == NULL) {
+    close(fd);
+    return NULL;
+  }
+
+  // only files of crashed processes hold an allocator pointer, it is
+  // replaced once the rest is checked
+  union _svec_preamble const *preamble = (void *)map->base;
+  struct _svec_mdi *data = _block(map);
+  if (memcmp(preamble->fields.magic, SVEC_MMAP_MAGIC,
+             sizeof SVEC_MMAP_MAGIC) != 0 ||
+      preamble->fields.version != SVEC_MMAP_VERSION ||
+      preamble->fields.word_size != sizeof(usz) || data->type_size != size ||
+      data->length > data->alloc ||
+      (size && data->alloc > (map->mapped - header) / size)) {
+    _unmap(map);
+    return NULL;
+  }
+
+  data->allocator = &map->allocator;
+  return data;
+}
+
+bool svec_is_mmap(void const *svec_ptr) { return _mapping(svec_ptr) != NULL; }
+
+bool svec_sync(void *svec_ptr) {
+  struct _svec_mmap *map = _mapping(svec_ptr);
+  return map != NULL && msync(map->base, map->mapped, MS_SYNC) == 0;
+}
+
+bool svec_advise(void *svec_ptr, enum svec_advice advice) {
+  struct _svec_mmap *map = _mapping(svec_ptr);
+  if (map == NULL) {
+    return false;
+  }
+
+  int flag = MADV_NORMAL;
+  switch (advice) {
+  case SVEC_ADVICE_NORMAL:
+    flag = MADV_NORMAL;
+    break;
+  case SVEC_ADVICE_SEQUENTIAL:
+    flag = MADV_SEQUENTIAL;
+    break;
+  case SVEC_ADVICE_RANDOM:
+    flag = MADV_RANDOM;
+    break;
+  case SVEC_ADVICE_WILLNEED:
+    flag = MADV_WILLNEED;
+    break;
+  }
+
+  return madvise(map->base, map->mapped, flag) == 0;
+}
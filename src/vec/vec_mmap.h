@@ -0,0 +1,103 @@
+/**
+ * @file vec_mmap.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief File-backed svecs mapped into memory
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ * The file holds a small preamble (magic, format version, word size) followed
+ * by the svec block itself, `struct _svec_mdi` and the items, so opening a
+ * file maps it and hands out the block without reading it. The svec gets an
+ * allocator that grows the file with ftruncate and the mapping with mremap,
+ * so svec_push, svec_append_array and svec_reserve work unchanged, as long as
+ * the returned pointer is kept. svec_destroy unmaps and closes the file.
+ * While mapped, the block holds the process-local allocator pointer, which
+ * svec_destroy clears before closing the file and opening ignores. Files use
+ * the native byte order and word size.
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @brief Version of the file format, bumped on incompatible changes.
+ */
+#define SVEC_MMAP_VERSION 1
+
+/**
+ * @enum  svec_advice
+ * @brief Expected access pattern of a mapped svec, passed on to madvise.
+ */
+enum svec_advice {
+  SVEC_ADVICE_NORMAL,     /**< No particular pattern. */
+  SVEC_ADVICE_SEQUENTIAL, /**< Items are read in order, read ahead. */
+  SVEC_ADVICE_RANDOM,     /**< Items are read in no order, do not read ahead. */
+  SVEC_ADVICE_WILLNEED,   /**< Items are needed soon, start reading them. */
+};
+
+/**
+ * @brief Creates a file, replacing any existing one, and maps an empty svec.
+ *
+ * @param path The path of the file.
+ * @param size The size of each element.
+ * @param capacity The number of elements to make room for.
+ * @return A pointer to the svec, NULL if the file could not be created.
+ */
+void *_svec_create_mmap(char const *path, usz size, usz capacity);
+
+/**
+ * @brief Maps the svec stored in a file.
+ *
+ * @param path The path of the file.
+ * @param size The size of each element, checked against the file.
+ * @return A pointer to the svec, NULL if the file could not be opened or
+ * does not hold an svec of elements of `size` bytes.
+ */
+void *_svec_open_mmap(char const *path, usz size);
+
+/**
+ * @brief Macro for creating a file-backed svec.
+ *
+ * @param TYPE The type of each element in the svec.
+ * @param PATH The path of the file.
+ * @param CAPACITY The number of elements to make room for.
+ */
+#define svec_create_mmap(TYPE, PATH, CAPACITY)                                 \
+  _svec_create_mmap((PATH), sizeof(TYPE), (CAPACITY))
+
+/**
+ * @brief Macro for mapping the svec stored in a file.
+ *
+ * @param PATH The path of the file.
+ * @param TYPE The type of each element in the svec.
+ */
+#define svec_open_mmap(PATH, TYPE) _svec_open_mmap((PATH), sizeof(TYPE))
+
+/**
+ * @brief Tells whether an svec is backed by a file.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @return True if the svec was made by svec_create_mmap or svec_open_mmap.
+ */
+bool svec_is_mmap(void const *svec_ptr);
+
+/**
+ * @brief Writes the changes of a file-backed svec to disk and waits for it.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @return True on success, false on error or if the svec is not file-backed.
+ */
+bool svec_sync(void *svec_ptr);
+
+/**
+ * @brief Hints the expected access pattern of a file-backed svec.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @param advice The access pattern.
+ * @return True on success, false on error or if the svec is not file-backed.
+ */
+bool svec_advise(void *svec_ptr, enum svec_advice advice);
@@ -0,0 +1,329 @@
+#define _POSIX_C_SOURCE 200809L
+#include "vec_par.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * @struct _tpool_range
+ * @brief The indices of a loop assigned to one thread.
+ *
+ * The owner and thieves all take indices from the front, so a single atomic
+ * counter is enough. Each range sits on its own cache line.
+ */
+struct _tpool_range {
+  _Alignas(VEC_CACHE_LINE) atomic_size_t next; /**< The next index to take. */
+  mut_usz end; /**< The index past the end of the range. */
+};
+
+/**
+ * @struct _tpool_job
+ * @brief A loop running on a pool.
+ */
+struct _tpool_job {
+  void (*body)(void *ctx, usz begin, usz end); /**< The loop body. */
+  void *ctx;                   /**< The context of the body. */
+  mut_usz grain;               /**< The indices taken at a time. */
+  struct _tpool_range *ranges; /**< One range per thread. */
+  atomic_size_t pending;       /**< The threads still running the loop. */
+};
+
+/**
+ * @struct _tpool_worker
+ * @brief The start argument of a worker thread.
+ */
+struct _tpool_worker {
+  struct vec_tpool *pool; /**< The pool of the worker. */
+  mut_usz id;             /**< The index of the worker's range. */
+};
+
+/**
+ * @struct vec_tpool
+ * @brief A pool of worker threads.
+ */
+struct vec_tpool {
+  pthread_mutex_t lock;            /**< Guards the fields below. */
+  pthread_cond_t wake;             /**< Signals a new job or stop. */
+  pthread_cond_t done;             /**< Signals the end of a job. */
+  pthread_mutex_t submit;          /**< Serializes the jobs. */
+  mut_usz generation;              /**< The number of jobs started. */
+  bool stop;                       /**< The workers should exit. */
+  struct _tpool_job *job;          /**< The current job. */
+  mut_usz threads;                 /**< The threads running a job. */
+  pthread_t *handles;              /**< The worker threads. */
+  struct _tpool_worker *workers;   /**< The arguments of the workers. */
+  struct _tpool_range *ranges;     /**< The ranges of the current job. */
+};
+
+static _Thread_local bool in_pool = false;
+
+/**
+ * @brief Runs a job on the calling thread until no index is left.
+ *
+ * Starts with the thread's own range, then steals from the others.
+ *
+ * @param job The job.
+ * @param id The index of the thread's own range.
+ * @param threads The number of ranges.
+ */
+static void _run(struct _tpool_job *job, usz id, usz threads) {
+  bool was_in_pool = in_pool;
+  in_pool = true;
+
+  for (mut_usz k = 0; k < threads; ++k) {
+    struct _tpool_range *range = &job->ranges[(id + k) % threads];
+    for (;;) {
+      usz begin = atomic_fetch_add_explicit(&range->next, job->grain,
+                                            memory_order_relaxed);
+      if (begin >= range->end) {
+        break;
+      }
+
+      usz end = range->end - begin < job->grain ? range->end
+                                                : begin + job->grain;
+      job->body(job->ctx, begin, end);
+    }
+  }
+
+  in_pool = was_in_pool;
+}
+
+/**
+ * @brief Marks the calling thread as done with a job.
+ *
+ * @param pool The pool.
+ * @param job The job, not to be touched afterwards.
+ */
+static void _finish(struct vec_tpool *pool, struct _tpool_job *job) {
+  if (atomic_fetch_sub_explicit(&job->pending, 1, memory_order_acq_rel) == 1) {
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->done);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+static void *_worker(void *arg) {
+  struct _tpool_worker *worker = arg;
+  struct vec_tpool *pool = worker->pool;
+  mut_usz seen = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->stop && pool->generation == seen) {
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    }
+
+    if (pool->stop) {
+      break;
+    }
+
+    seen = pool->generation;
+    struct _tpool_job *job = pool->job;
+    pthread_mutex_unlock(&pool->lock);
+
+    _run(job, worker->id, pool->threads);
+    _finish(pool, job);
+
+    pthread_mutex_lock(&pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+// pool functions
+struct vec_tpool *vec_tpool_init(usz threads) {
+  mut_usz count = threads;
+  if (count == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    count = online > 0 ? (usz)online : 1;
+  }
+
+  struct vec_tpool *pool = malloc(sizeof *pool);
+  pthread_t *handles = malloc(sizeof *handles * count);
+  struct _tpool_worker *workers = malloc(sizeof *workers * count);
+  struct _tpool_range *ranges =
+      aligned_alloc(VEC_CACHE_LINE, sizeof *ranges * count);
+  if (pool == NULL || handles == NULL || workers == NULL || ranges == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  *pool = (struct vec_tpool){.generation = 0,
+                             .stop = false,
+                             .job = NULL,
+                             .threads = count,
+                             .handles = handles,
+                             .workers = workers,
+                             .ranges = ranges};
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_mutex_init(&pool->submit, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pthread_cond_init(&pool->done, NULL);
+
+  for (mut_usz i = 1; i < count; ++i) {
+    workers[i] = (struct _tpool_worker){.pool = pool, .id = i};
+    if (pthread_create(&handles[i], NULL, _worker, &workers[i]) != 0) {
+      fprintf(stderr, "%s:%d - cannot create thread\n", __FILE__, __LINE__);
+      exit(1);
+    }
+  }
+
+  return pool;
+}
+
+void vec_tpool_destroy(struct vec_tpool *pool) {
+  if (pool == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (mut_usz i = 1; i < pool->threads; ++i) {
+    pthread_join(pool->handles[i], NULL);
+  }
+
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->wake);
+  pthread_mutex_destroy(&pool->submit);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->ranges);
+  free(pool->workers);
+  free(pool->handles);
+  free(pool);
+}
+
+static struct vec_tpool *default_pool = NULL;
+static pthread_once_t default_pool_once = PTHREAD_ONCE_INIT;
+
+static void _default_pool_destroy(void) { vec_tpool_destroy(default_pool); }
+
+static void _default_pool_init(void) {
+  default_pool = vec_tpool_init(0);
+  atexit(_default_pool_destroy);
+}
+
+struct vec_tpool *vec_tpool_default(void) {
+  pthread_once(&default_pool_once, _default_pool_init);
+  return default_pool;
+}
+
+mut_usz vec_tpool_threads(struct vec_tpool const *pool) {
+  return pool->threads;
+}
+
+void vec_tpool_for(struct vec_tpool *pool, usz count, usz grain,
+                   void (*body)(void *ctx, usz begin, usz end), void *ctx) {
+  usz step = grain ? grain : VEC_PAR_GRAIN;
+  if (count == 0) {
+    return;
+  }
+
+  if (in_pool || pool->threads == 1 || count <= step) {
+    body(ctx, 0, count);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->submit);
+
+  usz threads = pool->threads;
+  usz share = count / threads;
+  usz extra = count % threads;
+  mut_usz begin = 0;
+  for (mut_usz i = 0; i < threads; ++i) {
+    usz end = begin + share + (i < extra ? 1 : 0);
+    atomic_init(&pool->ranges[i].next, begin);
+    pool->ranges[i].end = end;
+    begin = end;
+  }
+
+  struct _tpool_job job = {
+      .body = body, .ctx = ctx, .grain = step, .ranges = pool->ranges};
+  atomic_init(&job.pending, threads);
+
+  pthread_mutex_lock(&pool->lock);
+  pool->job = &job;
+  pool->generation += 1;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  _run(&job, 0, threads);
+  atomic_fetch_sub_explicit(&job.pending, 1, memory_order_acq_rel);
+
+  pthread_mutex_lock(&pool->lock);
+  while (atomic_load_explicit(&job.pending, memory_order_acquire) != 0) {
+    pthread_cond_wait(&pool->done, &pool->lock);
+  }
+  pool->job = NULL;
+  pthread_mutex_unlock(&pool->lock);
+
+  pthread_mutex_unlock(&pool->submit);
+}
+
+// parallel vector functions
+
+/**
+ * @struct _foreach_ctx
+ * @brief The context of a parallel foreach.
+ */
+struct _foreach_ctx {
+  vec self;                                /**< The vector. */
+  void (*apply)(void *ctx, vec_item item); /**< The function to apply. */
+  void *ctx;                               /**< The context of `apply`. */
+};
+
+static void _foreach_range(void *ctx, usz begin, usz end) {
+  struct _foreach_ctx *foreach = ctx;
+  for (mut_usz i = begin; i < end; ++i) {
+    foreach->apply(foreach->ctx, _at(foreach->self, i));
+  }
+}
+
+/**
+ * @brief Calls a function without context, passed as the context.
+ *
+ * @param ctx The function.
+ * @param item The item.
+ */
+static void _apply_plain(void *ctx, vec_item item) {
+  void (**apply)(vec_item item) = ctx;
+  (*apply)(item);
+}
+
+void vec_par_foreach(vec self, void (*apply)(vec_item item), usz grain) {
+  if (apply == NULL) {
+    return;
+  }
+
+  vec_par_foreach_ctx(self, _apply_plain, &apply, grain);
+}
+
+void vec_par_foreach_ctx(vec self, void (*apply)(void *ctx, vec_item item),
+                         void *ctx, usz grain) {
+  if (apply == NULL) {
+    return;
+  }
+
+  _vec_unshare_items(self);
+  struct _foreach_ctx foreach = {.self = self, .apply = apply, .ctx = ctx};
+  vec_tpool_for(vec_tpool_default(), self->length, grain, _foreach_range,
+                &foreach);
+}
+
+vec vec_par_map(vec self, void (*apply)(vec_item item), usz grain) {
+  mut_vec new_vec = _vec_copy_range(self, 0, self->length);
+  vec_par_foreach(new_vec, apply, grain);
+  return new_vec;
+}
+
+vec vec_par_map_ctx(vec self, void (*apply)(void *ctx, vec_item item),
+                    void *ctx, usz grain) {
+  mut_vec new_vec = _vec_copy_range(self, 0, self->length);
+  vec_par_foreach_ctx(new_vec, apply, ctx, grain);
+  return new_vec;
+}
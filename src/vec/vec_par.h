@@ -0,0 +1,138 @@
+/**
+ * @file vec_par.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Work-stealing thread pool and parallel vector functions
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @struct  vec_tpool
+ * @brief A pool of worker threads running parallel loops.
+ *
+ * A loop over `count` indices is split into one contiguous range per thread.
+ * Threads take `grain` indices at a time from their own range and, once it is
+ * exhausted, steal from the ranges of the others. The calling thread takes
+ * part in the loop. Loops started from inside a loop body run sequentially.
+ */
+struct vec_tpool;
+
+/**
+ * @brief Default number of indices taken at a time by parallel functions.
+ */
+#define VEC_PAR_GRAIN 1024
+
+// pool functions
+
+/**
+ * @brief Initializes a new thread pool.
+ *
+ * @param threads The number of threads running a loop, including the caller,
+ * 0 for the number of online CPUs.
+ * @return Returns a new thread pool.
+ */
+struct vec_tpool *vec_tpool_init(usz threads);
+
+/**
+ * @brief Stops the threads of a pool and frees it.
+ *
+ * @param pool The pool to destroy.
+ */
+void vec_tpool_destroy(struct vec_tpool *pool);
+
+/**
+ * @brief Returns the shared pool used by the parallel vector functions.
+ *
+ * Created on first use with one thread per online CPU.
+ *
+ * @return The default pool.
+ */
+struct vec_tpool *vec_tpool_default(void);
+
+/**
+ * @brief Get the number of threads running a loop, including the caller.
+ *
+ * @param pool The pool.
+ * @return The number of threads.
+ */
+mut_usz vec_tpool_threads(struct vec_tpool const *pool);
+
+/**
+ * @brief Runs a loop over `count` indices on the pool.
+ *
+ * Returns once `body` has been called on ranges covering every index.
+ *
+ * @param pool The pool.
+ * @param count The number of indices.
+ * @param grain The number of indices handed out at a time, 0 for
+ * VEC_PAR_GRAIN.
+ * @param body The function called on each range [begin, end).
+ * @param ctx The context passed to `body`.
+ */
+void vec_tpool_for(struct vec_tpool *pool, usz count, usz grain,
+                   void (*body)(void *ctx, usz begin, usz end), void *ctx);
+
+// parallel vector functions
+
+/**
+ * @brief Applies a function to each item in a vector on the default pool.
+ *
+ * The function is called concurrently and may only touch its own item.
+ *
+ * @param self The vector.
+ * @param apply The function to apply to each item.
+ * @param grain The number of items handed out at a time, 0 for
+ * VEC_PAR_GRAIN.
+ */
+void vec_par_foreach(vec self, void (*apply)(vec_item item), usz grain);
+
+/**
+ * @brief Applies a function to each item of a copy of the vector in
+ * parallel.
+ *
+ * The copy is made first, then `apply` runs as with vec_par_foreach.
+ *
+ * @param self The vector.
+ * @param apply The function to apply to each item.
+ * @param grain The number of items handed out at a time, 0 for
+ * VEC_PAR_GRAIN.
+ * @return A new vector with the applied function.
+ */
+vec vec_par_map(vec self, void (*apply)(vec_item item), usz grain);
+
+/**
+ * @brief Applies a function taking a context to each item in a vector on
+ * the default pool.
+ *
+ * The context is shared by all threads, per-thread state (such as partial
+ * sums) has to be synchronized by `apply`.
+ *
+ * @param self The vector.
+ * @param apply The function to apply to each item.
+ * @param ctx The context passed to `apply`.
+ * @param grain The number of items handed out at a time, 0 for
+ * VEC_PAR_GRAIN.
+ */
+void vec_par_foreach_ctx(vec self, void (*apply)(void *ctx, vec_item item),
+                         void *ctx, usz grain);
+
+/**
+ * @brief Applies a function taking a context to each item of a copy of the
+ * vector in parallel.
+ *
+ * @param self The vector.
+ * @param apply The function to apply to each item.
+ * @param ctx The context passed to `apply`.
+ * @param grain The number of items handed out at a time, 0 for
+ * VEC_PAR_GRAIN.
+ * @return A new vector with the applied function.
+ */
+vec vec_par_map_ctx(vec self, void (*apply)(void *ctx, vec_item item),
+                    void *ctx, usz grain);
@@ -0,0 +1,284 @@
+#include "vec_ring.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+/**
+ * @struct _ring_end
+ * @brief The index of one end of a ring, written by the threads at that end.
+ */
+struct _ring_end {
+  atomic_size_t index; /**< The number of items pushed or popped so far. */
+  mut_usz other;       /**< SPSC only, the last index seen at the other end. */
+};
+
+/**
+ * @struct vec_ring
+ * @brief A ring, followed by the slot sequence numbers (MPMC only) and the
+ * items.
+ *
+ * The header is read-only after initialization; the pads keep it and the two
+ * ends on separate cache lines wherever the block lands.
+ */
+struct vec_ring {
+  struct _svec_mdi mdi;    /**< alloc is the capacity, length is unused. */
+  mut_usz mask;            /**< The capacity minus one. */
+  enum vec_ring_mode mode; /**< The threads allowed at each end. */
+  char header_pad[VEC_CACHE_LINE];
+  struct _ring_end tail; /**< Written by producers. */
+  char tail_pad[VEC_CACHE_LINE - sizeof(struct _ring_end)];
+  struct _ring_end head; /**< Written by consumers. */
+  char head_pad[VEC_CACHE_LINE - sizeof(struct _ring_end)];
+};
+
+static mut_usz _round_up(usz size, usz align) {
+  return (size + align - 1) / align * align;
+}
+
+static mut_usz _sequences_size(usz capacity, enum vec_ring_mode mode) {
+  return mode == VEC_RING_MPMC ? capacity * sizeof(atomic_size_t) : 0;
+}
+
+static mut_usz _items_offset(struct vec_ring const *self) {
+  return _round_up(sizeof *self + _sequences_size(self->mdi.alloc, self->mode),
+                   sizeof(max_align_t));
+}
+
+static mut_usz _block_size(struct vec_ring const *self) {
+  return _items_offset(self) + self->mdi.alloc * self->mdi.type_size;
+}
+
+static atomic_size_t *_sequences(struct vec_ring *self) {
+  return (atomic_size_t *)(void *)(self + 1);
+}
+
+static unsigned char *_items(struct vec_ring *self) {
+  return (unsigned char *)self + _items_offset(self);
+}
+
+/**
+ * @brief Copies items into the slots starting at an index, wrapping around.
+ */
+static void _copy_in(struct vec_ring *self, usz index,
+                     unsigned char const *items, usz count) {
+  usz size = self->mdi.type_size;
+  usz start = index & self->mask;
+  usz first = count < self->mdi.alloc - start ? count : self->mdi.alloc - start;
+  memcpy(_items(self) + start * size, items, first * size);
+  memcpy(_items(self), items + first * size, (count - first) * size);
+}
+
+/**
+ * @brief Copies items out of the slots starting at an index, wrapping around.
+ */
+static void _copy_out(struct vec_ring *self, usz index, unsigned char *items,
+                      usz count) {
+  usz size = self->mdi.type_size;
+  usz start = index & self->mask;
+  usz first = count < self->mdi.alloc - start ? count : self->mdi.alloc - start;
+  memcpy(items, _items(self) + start * size, first * size);
+  memcpy(items + first * size, _items(self), (count - first) * size);
+}
+
+struct vec_ring *vec_ring_init(usz item_size, usz capacity,
+                               enum vec_ring_mode mode) {
+  return vec_ring_init_with(item_size, capacity, mode, NULL);
+}
+
+struct vec_ring *vec_ring_init_with(usz item_size, usz capacity,
+                                    enum vec_ring_mode mode,
+                                    vec_allocator *allocator) {
+  mut_usz rounded = 2;
+  while (rounded < capacity) {
+    if (rounded > USZ_MAX / 2) {
+      OUT_OF_MEMORY;
+    }
+    rounded *= 2;
+  }
+
+  usz header = _round_up(sizeof(struct vec_ring) +
+                             _sequences_size(rounded, mode),
+                         sizeof(max_align_t));
+  if (item_size && rounded > (USZ_MAX - header) / item_size) {
+    OUT_OF_MEMORY;
+  }
+
+  struct vec_ring *self =
+      _vec_allocate(allocator, header + rounded * item_size);
+  self->mdi.length = 0;
+  self->mdi.alloc = rounded;
+  self->mdi.type_size = item_size;
+  self->mdi.allocator = allocator;
+  self->mask = rounded - 1;
+  self->mode = mode;
+  atomic_init(&self->tail.index, 0);
+  self->tail.other = 0;
+  atomic_init(&self->head.index, 0);
+  self->head.other = 0;
+
+  if (mode == VEC_RING_MPMC) {
+    atomic_size_t *sequences = _sequences(self);
+    for (mut_usz i = 0; i < rounded; ++i) {
+      atomic_init(&sequences[i], i);
+    }
+  }
+
+  return self;
+}
+
+void vec_ring_destroy(struct vec_ring *self) {
+  if (self == NULL) {
+    return;
+  }
+
+  _vec_release(self->mdi.allocator, self, _block_size(self));
+}
+
+mut_usz vec_ring_capacity(struct vec_ring const *self) {
+  return self->mdi.alloc;
+}
+
+mut_usz vec_ring_length(struct vec_ring const *self) {
+  usz head = atomic_load_explicit(&self->head.index, memory_order_acquire);
+  usz tail = atomic_load_explicit(&self->tail.index, memory_order_acquire);
+  return tail > head ? tail - head : 0;
+}
+
+/**
+ * @brief Pushes into an SPSC ring, only the producer writes the tail.
+ */
+static mut_usz _spsc_push(struct vec_ring *self, unsigned char const *items,
+                          usz count) {
+  usz tail = atomic_load_explicit(&self->tail.index, memory_order_relaxed);
+  if (self->mdi.alloc - (tail - self->tail.other) < count) {
+    self->tail.other =
+        atomic_load_explicit(&self->head.index, memory_order_acquire);
+  }
+
+  usz room = self->mdi.alloc - (tail - self->tail.other);
+  usz pushed = count < room ? count : room;
+  _copy_in(self, tail, items, pushed);
+  atomic_store_explicit(&self->tail.index, tail + pushed,
+                        memory_order_release);
+  return pushed;
+}
+
+/**
+ * @brief Pops from an SPSC ring, only the consumer writes the head.
+ */
+static mut_usz _spsc_pop(struct vec_ring *self, unsigned char *items,
+                         usz count) {
+  usz head = atomic_load_explicit(&self->head.index, memory_order_relaxed);
+  if (self->head.other - head < count) {
+    self->head.other =
+        atomic_load_explicit(&self->tail.index, memory_order_acquire);
+  }
+
+  usz ready = self->head.other - head;
+  usz popped = count < ready ? count : ready;
+  _copy_out(self, head, items, popped);
+  atomic_store_explicit(&self->head.index, head + popped,
+                        memory_order_release);
+  return popped;
+}
+
+/**
+ * @brief Claims a run of slots at one end of an MPMC ring.
+ *
+ * A slot is ready for a producer at index i when its sequence is i, and for
+ * a consumer when it is i + 1. The run is the ready prefix of `count` slots,
+ * claimed by moving the end index past it.
+ *
+ * @param self The ring.
+ * @param end The end to claim at.
+ * @param lag 0 for producers, 1 for consumers.
+ * @param count The largest number of slots to claim.
+ * @param claimed Receives the number of slots claimed.
+ * @return The index of the first slot claimed.
+ */
+static mut_usz _mpmc_claim(struct vec_ring *self, struct _ring_end *end,
+                           usz lag, usz count, mut_usz *claimed) {
+  atomic_size_t *sequences = _sequences(self);
+  mut_usz index = atomic_load_explicit(&end->index, memory_order_relaxed);
+
+  for (;;) {
+    mut_usz ready = 0;
+    bool behind = false;
+    while (ready < count) {
+      usz slot = index + ready;
+      usz sequence = atomic_load_explicit(&sequences[slot & self->mask],
+                                          memory_order_acquire);
+      if (sequence != slot + lag) {
+        // a sequence ahead of the slot means another thread claimed it
+        behind = (ptrdiff_t)(sequence - (slot + lag)) > 0;
+        break;
+      }
+      ready += 1;
+    }
+
+    if (ready == 0 && !behind) {
+      *claimed = 0;
+      return index;
+    }
+
+    if (ready != 0 && atomic_compare_exchange_weak_explicit(
+                          &end->index, &index, index + ready,
+                          memory_order_relaxed, memory_order_relaxed)) {
+      *claimed = ready;
+      return index;
+    }
+
+    if (ready == 0) {
+      index = atomic_load_explicit(&end->index, memory_order_relaxed);
+    }
+  }
+}
+
+static mut_usz _mpmc_push(struct vec_ring *self, unsigned char const *items,
+                          usz count) {
+  mut_usz pushed = 0;
+  usz first = _mpmc_claim(self, &self->tail, 0, count, &pushed);
+  _copy_in(self, first, items, pushed);
+
+  atomic_size_t *sequences = _sequences(self);
+  for (mut_usz i = 0; i < pushed; ++i) {
+    atomic_store_explicit(&sequences[(first + i) & self->mask], first + i + 1,
+                          memory_order_release);
+  }
+  return pushed;
+}
+
+static mut_usz _mpmc_pop(struct vec_ring *self, unsigned char *items,
+                         usz count) {
+  mut_usz popped = 0;
+  usz first = _mpmc_claim(self, &self->head, 1, count, &popped);
+  _copy_out(self, first, items, popped);
+
+  // the slot is free again for the push one lap later
+  atomic_size_t *sequences = _sequences(self);
+  for (mut_usz i = 0; i < popped; ++i) {
+    atomic_store_explicit(&sequences[(first + i) & self->mask],
+                          first + i + self->mdi.alloc, memory_order_release);
+  }
+  return popped;
+}
+
+bool vec_ring_push(struct vec_ring *self, void const *item) {
+  return vec_ring_push_batch(self, item, 1) == 1;
+}
+
+bool vec_ring_pop(struct vec_ring *self, void *item) {
+  return vec_ring_pop_batch(self, item, 1) == 1;
+}
+
+mut_usz vec_ring_push_batch(struct vec_ring *self, void const *items,
+                            usz count) {
+  return self->mode == VEC_RING_MPMC ? _mpmc_push(self, items, count)
+                                     : _spsc_push(self, items, count);
+}
+
+mut_usz vec_ring_pop_batch(struct vec_ring *self, void *items, usz count) {
+  return self->mode == VEC_RING_MPMC ? _mpmc_pop(self, items, count)
+                                     : _spsc_pop(self, items, count);
+}
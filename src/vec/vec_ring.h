@@ -0,0 +1,131 @@
+/**
+ * @file vec_ring.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Bounded lock-free ring buffer for passing items between threads
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @struct  vec_ring
+ * @brief A bounded first-in first-out queue of items stored by value.
+ *
+ * Laid out like an svec: a `struct _svec_mdi` header followed by the items in
+ * the same block, so nothing is allocated after initialization. The head and
+ * tail indices sit on their own cache lines. An SPSC ring is used by one
+ * producer and one consumer thread, and each end caches the index of the
+ * other to touch the shared line only when the ring looks full or empty. An
+ * MPMC ring can be used by any number of threads at both ends; each slot
+ * carries a sequence number telling whether it is free or full in the
+ * current lap.
+ */
+struct vec_ring;
+
+/**
+ * @enum  vec_ring_mode
+ * @brief The threads allowed at each end of a ring.
+ */
+enum vec_ring_mode {
+  VEC_RING_SPSC, /**< A single producer and a single consumer. */
+  VEC_RING_MPMC, /**< Any number of producers and consumers. */
+};
+
+/**
+ * @brief Initializes a ring using malloc.
+ *
+ * @param item_size The size of an item.
+ * @param capacity The number of items, rounded up to a power of two.
+ * @param mode The threads allowed at each end.
+ * @return Returns a new ring.
+ */
+struct vec_ring *vec_ring_init(usz item_size, usz capacity,
+                               enum vec_ring_mode mode);
+
+/**
+ * @brief Initializes a ring using a custom allocator.
+ *
+ * @param item_size The size of an item.
+ * @param capacity The number of items, rounded up to a power of two.
+ * @param mode The threads allowed at each end.
+ * @param allocator The allocator for the ring block, NULL for malloc.
+ * @return Returns a new ring.
+ */
+struct vec_ring *vec_ring_init_with(usz item_size, usz capacity,
+                                    enum vec_ring_mode mode,
+                                    vec_allocator *allocator);
+
+/**
+ * @brief Frees a ring, the items left in it are dropped.
+ *
+ * @param self The ring, may be NULL.
+ */
+void vec_ring_destroy(struct vec_ring *self);
+
+/**
+ * @brief Get the number of items the ring can hold.
+ *
+ * @param self The ring.
+ * @return The capacity.
+ */
+mut_usz vec_ring_capacity(struct vec_ring const *self);
+
+/**
+ * @brief Get the number of items in the ring.
+ *
+ * Only a hint while other threads use the ring.
+ *
+ * @param self The ring.
+ * @return The number of items.
+ */
+mut_usz vec_ring_length(struct vec_ring const *self);
+
+/**
+ * @brief Appends a copy of an item unless the ring is full.
+ *
+ * @param self The ring.
+ * @param item The address of the item.
+ * @return True if the item was appended, false if the ring is full.
+ */
+bool vec_ring_push(struct vec_ring *self, void const *item);
+
+/**
+ * @brief Removes the oldest item unless the ring is empty.
+ *
+ * @param self The ring.
+ * @param item Receives the item.
+ * @return True if an item was removed, false if the ring is empty.
+ */
+bool vec_ring_pop(struct vec_ring *self, void *item);
+
+/**
+ * @brief Appends copies of as many items as fit.
+ *
+ * The items take consecutive slots claimed at once, so they are popped in
+ * order and never interleaved with the items of other producers. Each slot
+ * is published on its own, so consumers may see the first items of the
+ * batch before the rest.
+ *
+ * @param self The ring.
+ * @param items The items.
+ * @param count The number of items.
+ * @return The number of items appended, from the start of `items`.
+ */
+mut_usz vec_ring_push_batch(struct vec_ring *self, void const *items,
+                            usz count);
+
+/**
+ * @brief Removes up to `count` of the oldest items.
+ *
+ * @param self The ring.
+ * @param items Receives the items.
+ * @param count The largest number of items to remove.
+ * @return The number of items removed.
+ */
+mut_usz vec_ring_pop_batch(struct vec_ring *self, void *items, usz count);
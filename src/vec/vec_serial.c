@@ -0,0 +1,478 @@
+#define _POSIX_C_SOURCE 200809L
+#include "vec_serial.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+#include <errno.h>
+#include <unistd.h>
+
+/**
+ * @enum _record_kind
+ * @brief What a record holds.
+ */
+enum _record_kind {
+  _RECORD_SVEC = 1,  /**< An svec. */
+  _RECORD_SVECS = 2, /**< The number of rows of a vector of svecs. */
+};
+
+/**
+ * @struct _record
+ * @brief The start of a record, followed by the svec block.
+ *
+ * As in the block of an svec, `length` and `alloc` of the header are equal
+ * and its allocator is meaningless.
+ */
+struct _record {
+  char magic[4];         /**< SVEC_SERIAL_MAGIC. */
+  mut_u16 version;       /**< SVEC_SERIAL_VERSION. */
+  mut_u8 kind;           /**< The enum _record_kind. */
+  mut_u8 word_size;      /**< The size of usz when the record was written. */
+  mut_u64 payload;       /**< The size of the rest of the record. */
+  struct _svec_mdi head; /**< The header of the svec block. */
+};
+
+/**
+ * @brief The size of a record before the svec block, not counted in payload.
+ */
+#define PREAMBLE_SIZE offsetof(struct _record, head)
+
+/**
+ * @brief Largest run of items read from a file at once.
+ */
+#define SERIAL_READ_CHUNK ((usz)64 * 1024)
+
+_Static_assert(sizeof(struct _record) % SVEC_SERIAL_ALIGN == 0,
+               "the items of a record must stay aligned");
+
+/**
+ * @brief Identifies records.
+ */
+static char const SVEC_SERIAL_MAGIC[4] = {'s', 'v', 'e', 'c'};
+
+/**
+ * @brief Zero bytes written as padding.
+ */
+static unsigned char const zeros[SVEC_SERIAL_ALIGN];
+
+// allocator of svecs used in place
+
+/**
+ * @brief Copies an svec used in place into malloc memory.
+ *
+ * @param ctx Unused.
+ * @param ptr The block in the buffer.
+ * @param old_size The size of the block.
+ * @param new_size The requested size of the block.
+ * @return The new block, owned by malloc from now on.
+ */
+static void *_borrowed_reallocate(void *ctx, void *ptr, usz old_size,
+                                  usz new_size) {
+  (void)ctx;
+  struct _svec_mdi *data = _vec_allocate(NULL, new_size);
+  memcpy(data, ptr, old_size < new_size ? old_size : new_size);
+  data->allocator = NULL;
+  return data;
+}
+
+/**
+ * @brief Leaves the buffer of an svec used in place alone.
+ */
+static void _borrowed_release(void *ctx, void *ptr, usz size) {
+  (void)ctx;
+  (void)ptr;
+  (void)size;
+}
+
+static vec_allocator borrowed = {
+    .allocate = _svec_block_allocate,
+    .reallocate = _borrowed_reallocate,
+    .release = _borrowed_release,
+    .ctx = NULL,
+};
+
+// record helpers
+
+static mut_usz _padded(usz size) {
+  return (size + SVEC_SERIAL_ALIGN - 1) / SVEC_SERIAL_ALIGN * SVEC_SERIAL_ALIGN;
+}
+
+/**
+ * @brief Fills in the start of a record.
+ *
+ * @param record The record.
+ * @param kind The kind of record.
+ * @param length The number of items or rows.
+ * @param type_size The size of an item, 0 for rows.
+ * @param size The size of the whole record.
+ */
+static void _fill(struct _record *record, enum _record_kind kind, usz length,
+                  usz type_size, usz size) {
+  *record = (struct _record){0};
+  memcpy(record->magic, SVEC_SERIAL_MAGIC, sizeof SVEC_SERIAL_MAGIC);
+  record->version = SVEC_SERIAL_VERSION;
+  record->kind = (mut_u8)kind;
+  record->word_size = sizeof(usz);
+  record->payload = size - PREAMBLE_SIZE;
+  record->head.length = length;
+  record->head.alloc = length;
+  record->head.type_size = type_size;
+}
+
+/**
+ * @brief Checks the start of a record read from outside.
+ *
+ * @param record The record.
+ * @param kind The expected kind of record.
+ * @param type_size The expected size of an item, ignored for rows.
+ * @param size Receives the size of the whole record.
+ * @return True if the record is valid, false otherwise.
+ */
+static bool _check(struct _record const *record, enum _record_kind kind,
+                   usz type_size, mut_usz *size) {
+  if (memcmp(record->magic, SVEC_SERIAL_MAGIC, sizeof SVEC_SERIAL_MAGIC) !=
+          0 ||
+      record->version != SVEC_SERIAL_VERSION || record->kind != kind ||
+      record->word_size != sizeof(usz) ||
+      record->head.length != record->head.alloc ||
+      record->payload > USZ_MAX - PREAMBLE_SIZE) {
+    return false;
+  }
+
+  *size = PREAMBLE_SIZE + (usz)record->payload;
+  if (kind == _RECORD_SVECS) {
+    // every row takes at least a record start
+    return *size >= sizeof *record &&
+           record->head.length <= (*size - sizeof *record) / sizeof *record;
+  }
+
+  usz items = record->head.length;
+  return record->head.type_size == type_size &&
+         (type_size == 0 ||
+          items <= (USZ_MAX - sizeof *record) / type_size) &&
+         *size == sizeof *record + _padded(items * type_size);
+}
+
+static bool _write_all(int fd, void const *data, usz size) {
+  unsigned char const *bytes = data;
+  for (mut_usz done = 0; done < size;) {
+    ssize_t written = write(fd, bytes + done, size - done);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    done += (usz)written;
+  }
+
+  return true;
+}
+
+static bool _read_all(int fd, void *data, usz size) {
+  unsigned char *bytes = data;
+  for (mut_usz done = 0; done < size;) {
+    ssize_t got = read(fd, bytes + done, size - done);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    done += (usz)got;
+  }
+
+  return true;
+}
+
+// svec functions
+
+mut_usz svec_serialized_size(void const *svec_ptr) {
+  struct _svec_mdi const *data = svec_ptr;
+  return sizeof(struct _record) + _padded(data->length * data->type_size);
+}
+
+mut_usz svec_write_buffer(void const *svec_ptr, void *buffer, usz size) {
+  struct _svec_mdi const *data = svec_ptr;
+  usz total = svec_serialized_size(svec_ptr);
+  if (size < total) {
+    return 0;
+  }
+
+  struct _record record;
+  _fill(&record, _RECORD_SVEC, data->length, data->type_size, total);
+  usz bytes = data->length * data->type_size;
+  unsigned char *out = buffer;
+  memcpy(out, &record, sizeof record);
+  memcpy(out + sizeof record, data + 1, bytes);
+  memset(out + sizeof record + bytes, 0, total - sizeof record - bytes);
+  return total;
+}
+
+bool svec_write(void const *svec_ptr, int fd) {
+  struct _svec_mdi const *data = svec_ptr;
+  usz total = svec_serialized_size(svec_ptr);
+
+  struct _record record;
+  _fill(&record, _RECORD_SVEC, data->length, data->type_size, total);
+  usz bytes = data->length * data->type_size;
+  return _write_all(fd, &record, sizeof record) &&
+         _write_all(fd, data + 1, bytes) &&
+         _write_all(fd, zeros, total - sizeof record - bytes);
+}
+
+/**
+ * @brief Reads the record of an svec from a file.
+ *
+ * The items are read in runs of SERIAL_READ_CHUNK bytes and the svec grows
+ * as they arrive, so a forged length fails at the end of the stream instead
+ * of allocating it up front.
+ *
+ * @param fd The file.
+ * @param size The size of each element.
+ * @param used Receives the size of the record.
+ * @return A pointer to a new svec, NULL on a read error or invalid record.
+ */
+static void *_read_svec(int fd, usz size, mut_usz *used) {
+  struct _record record;
+  mut_usz total = 0;
+  if (!_read_all(fd, &record, sizeof record) ||
+      !_check(&record, _RECORD_SVEC, size, &total)) {
+    return NULL;
+  }
+
+  usz length = record.head.length;
+  usz step = size == 0                        ? length
+             : size < SERIAL_READ_CHUNK ? SERIAL_READ_CHUNK / size
+                                        : 1;
+  struct _svec_mdi *data =
+      _svec_with_capacity(size, length < step ? length : step, NULL);
+  while (data->length < length) {
+    usz run = length - data->length < step ? length - data->length : step;
+    if (data->alloc - data->length < run) {
+      usz doubled = data->alloc > length / 2 ? length : data->alloc * 2;
+      data = _svec_reserve(data, doubled > data->length + run
+                                     ? doubled
+                                     : data->length + run);
+    }
+
+    if (!_read_all(fd, (unsigned char *)(data + 1) + data->length * size,
+                   run * size)) {
+      svec_destroy(data);
+      return NULL;
+    }
+    data->length += run;
+  }
+
+  unsigned char pad[SVEC_SERIAL_ALIGN];
+  if (!_read_all(fd, pad, total - sizeof record - length * size)) {
+    svec_destroy(data);
+    return NULL;
+  }
+
+  *used = total;
+  return data;
+}
+
+void *_svec_read(int fd, usz size) {
+  mut_usz used = 0;
+  return _read_svec(fd, size, &used);
+}
+
+void *_svec_read_buffer(void const *buffer, usz size, usz type_size,
+                        mut_usz *used) {
+  struct _record record;
+  mut_usz total = 0;
+  if (size < sizeof record) {
+    return NULL;
+  }
+
+  memcpy(&record, buffer, sizeof record);
+  if (!_check(&record, _RECORD_SVEC, type_size, &total) || total > size) {
+    return NULL;
+  }
+
+  struct _svec_mdi *data =
+      _svec_with_capacity(type_size, record.head.length, NULL);
+  memcpy(data + 1, (unsigned char const *)buffer + sizeof record,
+         record.head.length * type_size);
+  data->length = record.head.length;
+  if (used != NULL) {
+    *used = total;
+  }
+  return data;
+}
+
+void *_svec_from_buffer(void *buffer, usz size, usz type_size, mut_usz *used) {
+  struct _record *record = buffer;
+  mut_usz total = 0;
+  if ((uptr)buffer % SVEC_SERIAL_ALIGN != 0 || size < sizeof *record ||
+      !_check(record, _RECORD_SVEC, type_size, &total) || total > size) {
+    return NULL;
+  }
+
+  record->head.allocator = &borrowed;
+  if (used != NULL) {
+    *used = total;
+  }
+  return &record->head;
+}
+
+// vector of svecs functions
+
+mut_usz vec_svecs_serialized_size(vec self) {
+  if (self->interface.flat) {
+    return 0;
+  }
+
+  mut_usz total = sizeof(struct _record);
+  for (mut_usz i = 0; i < self->length; ++i) {
+    total += svec_serialized_size(_at(self, i));
+  }
+
+  return total;
+}
+
+mut_usz vec_svecs_write_buffer(vec self, void *buffer, usz size) {
+  if (self->interface.flat) {
+    return 0;
+  }
+
+  usz total = vec_svecs_serialized_size(self);
+  if (size < total) {
+    return 0;
+  }
+
+  struct _record record;
+  _fill(&record, _RECORD_SVECS, self->length, 0, total);
+  unsigned char *out = buffer;
+  memcpy(out, &record, sizeof record);
+
+  mut_usz done = sizeof record;
+  for (mut_usz i = 0; i < self->length; ++i) {
+    done += svec_write_buffer(_at(self, i), out + done, size - done);
+  }
+
+  return done;
+}
+
+bool vec_svecs_write(vec self, int fd) {
+  if (self->interface.flat) {
+    return false;
+  }
+
+  struct _record record;
+  _fill(&record, _RECORD_SVECS, self->length, 0,
+        vec_svecs_serialized_size(self));
+  if (!_write_all(fd, &record, sizeof record)) {
+    return false;
+  }
+
+  for (mut_usz i = 0; i < self->length; ++i) {
+    if (!svec_write(_at(self, i), fd)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+mut_vec _vec_svecs_read(int fd, usz size, vec_interface interface) {
+  struct _record record;
+  mut_usz total = 0;
+  if (!_read_all(fd, &record, sizeof record) ||
+      !_check(&record, _RECORD_SVECS, size, &total)) {
+    return NULL;
+  }
+
+  // the rows are read one by one, the vector grows as they arrive
+  mut_vec self = vec_init(interface);
+  mut_usz done = sizeof record;
+  for (mut_usz i = 0; i < record.head.length; ++i) {
+    mut_usz row_size = 0;
+    void *row = done < total ? _read_svec(fd, size, &row_size) : NULL;
+    if (row == NULL || row_size > total - done) {
+      svec_destroy(row);
+      vec_destroy(self);
+      return NULL;
+    }
+    vec_push(self, row);
+    done += row_size;
+  }
+
+  if (done != total) {
+    vec_destroy(self);
+    return NULL;
+  }
+  return self;
+}
+
+/**
+ * @brief Reads the rows of a vector of svecs out of a buffer.
+ *
+ * @param buffer The buffer.
+ * @param size The size of the buffer.
+ * @param type_size The size of each element of the rows.
+ * @param interface The interface of the new vector.
+ * @param used Receives the size of the records, may be NULL.
+ * @param row Reads one row, as _svec_read_buffer or _svec_from_buffer.
+ * @return Returns a new vector, NULL if a record is invalid.
+ */
+static mut_vec _svecs_from(unsigned char *buffer, usz size, usz type_size,
+                           vec_interface interface, mut_usz *used,
+                           void *(*row)(unsigned char *buffer, usz size,
+                                        usz type_size, mut_usz *used)) {
+  struct _record record;
+  mut_usz total = 0;
+  if (size < sizeof record) {
+    return NULL;
+  }
+
+  memcpy(&record, buffer, sizeof record);
+  if (!_check(&record, _RECORD_SVECS, type_size, &total) || total > size) {
+    return NULL;
+  }
+
+  mut_vec self = vec_with_capacity(interface, record.head.length);
+  mut_usz done = sizeof record;
+  for (mut_usz i = 0; i < record.head.length; ++i) {
+    mut_usz row_size = 0;
+    void *item = row(buffer + done, total - done, type_size, &row_size);
+    if (item == NULL) {
+      vec_destroy(self);
+      return NULL;
+    }
+    vec_push(self, item);
+    done += row_size;
+  }
+
+  if (done != total) {
+    vec_destroy(self);
+    return NULL;
+  }
+
+  if (used != NULL) {
+    *used = total;
+  }
+  return self;
+}
+
+static void *_row_copy(unsigned char *buffer, usz size, usz type_size,
+                       mut_usz *used) {
+  return _svec_read_buffer(buffer, size, type_size, used);
+}
+
+static void *_row_in_place(unsigned char *buffer, usz size, usz type_size,
+                           mut_usz *used) {
+  return _svec_from_buffer(buffer, size, type_size, used);
+}
+
+mut_vec _vec_svecs_read_buffer(void const *buffer, usz size, usz type_size,
+                               vec_interface interface, mut_usz *used) {
+  // the rows are only read, the cast lets both readers share the loop
+  return _svecs_from((unsigned char *)(uptr)buffer, size, type_size,
+                     interface, used, _row_copy);
+}
+
+mut_vec _vec_svecs_from_buffer(void *buffer, usz size, usz type_size,
+                               vec_interface interface, mut_usz *used) {
+  return _svecs_from(buffer, size, type_size, interface, used, _row_in_place);
+}
@@ -0,0 +1,242 @@
+/**
+ * @file vec_serial.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Binary serialization of svecs and vectors of svecs
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ * A record is a 16 byte preamble (magic, format version, kind, word size and
+ * the length of the rest) followed by the svec block as it sits in memory:
+ * `struct _svec_mdi` and the items, padded to a multiple of
+ * SVEC_SERIAL_ALIGN. Records written back to back stay aligned, and a record
+ * in an aligned buffer can be used in place by svec_from_buffer. A vector of
+ * svecs is a record holding the number of rows, followed by one record per
+ * row. Records use the native byte order and word size, files from another
+ * machine are rejected.
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @brief Version of the record format, bumped on incompatible changes.
+ */
+#define SVEC_SERIAL_VERSION 1
+
+/**
+ * @brief Alignment of records, and of buffers passed to svec_from_buffer.
+ */
+#define SVEC_SERIAL_ALIGN 16
+
+// svec functions
+
+/**
+ * @brief Get the size of the record of an svec.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @return The number of bytes written by svec_write_buffer.
+ */
+mut_usz svec_serialized_size(void const *svec_ptr);
+
+/**
+ * @brief Writes the record of an svec into a buffer.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @param buffer The buffer.
+ * @param size The size of the buffer.
+ * @return The number of bytes written, 0 if the buffer is too small.
+ */
+mut_usz svec_write_buffer(void const *svec_ptr, void *buffer, usz size);
+
+/**
+ * @brief Writes the record of an svec to a file descriptor.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @param fd The file descriptor.
+ * @return True on success, false on a write error.
+ */
+bool svec_write(void const *svec_ptr, int fd);
+
+/**
+ * @brief Reads the record of an svec from a file descriptor.
+ *
+ * The items are read straight into the new svec.
+ *
+ * @param fd The file descriptor.
+ * @param size The size of each element, checked against the record.
+ * @return A pointer to a new svec, NULL on a read error or invalid record.
+ */
+void *_svec_read(int fd, usz size);
+
+/**
+ * @brief Copies the record of an svec out of a buffer.
+ *
+ * @param buffer The buffer.
+ * @param size The size of the buffer.
+ * @param type_size The size of each element, checked against the record.
+ * @param used Receives the size of the record, may be NULL.
+ * @return A pointer to a new svec, NULL if the record is invalid.
+ */
+void *_svec_read_buffer(void const *buffer, usz size, usz type_size,
+                        mut_usz *used);
+
+/**
+ * @brief Uses the record of an svec in place, without copying the items.
+ *
+ * Only the allocator field of the record is rewritten, so the buffer has to
+ * be writable, aligned to SVEC_SERIAL_ALIGN and outlive the svec. The items
+ * can be modified in place. svec_destroy leaves the buffer alone, and
+ * growing the svec moves it to malloc.
+ *
+ * @param buffer The buffer.
+ * @param size The size of the buffer.
+ * @param type_size The size of each element, checked against the record.
+ * @param used Receives the size of the record, may be NULL.
+ * @return A pointer to the svec inside the buffer, NULL if the record is
+ * invalid or the buffer misaligned.
+ */
+void *_svec_from_buffer(void *buffer, usz size, usz type_size, mut_usz *used);
+
+/**
+ * @brief Macro for reading an svec from a file descriptor.
+ *
+ * @param FD The file descriptor.
+ * @param TYPE The type of each element in the svec.
+ */
+#define svec_read(FD, TYPE) _svec_read((FD), sizeof(TYPE))
+
+/**
+ * @brief Macro for copying an svec out of a buffer.
+ *
+ * @param BUFFER The buffer.
+ * @param SIZE The size of the buffer.
+ * @param TYPE The type of each element in the svec.
+ * @param USED Receives the size of the record, may be NULL.
+ */
+#define svec_read_buffer(BUFFER, SIZE, TYPE, USED)                             \
+  _svec_read_buffer((BUFFER), (SIZE), sizeof(TYPE), (USED))
+
+/**
+ * @brief Macro for using an svec in place in a buffer.
+ *
+ * @param BUFFER The buffer.
+ * @param SIZE The size of the buffer.
+ * @param TYPE The type of each element in the svec.
+ * @param USED Receives the size of the record, may be NULL.
+ */
+#define svec_from_buffer(BUFFER, SIZE, TYPE, USED)                             \
+  _svec_from_buffer((BUFFER), (SIZE), sizeof(TYPE), (USED))
+
+// vector of svecs functions
+
+/**
+ * @brief Get the size of the records of a vector of svecs.
+ *
+ * The vector holds svec pointers (pointer mode), as the matrix of
+ * example2.c.
+ *
+ * @param self The vector.
+ * @return The number of bytes written by vec_svecs_write_buffer, 0 for a
+ * vector in flat mode.
+ */
+mut_usz vec_svecs_serialized_size(vec self);
+
+/**
+ * @brief Writes the records of a vector of svecs into a buffer.
+ *
+ * @param self The vector.
+ * @param buffer The buffer.
+ * @param size The size of the buffer.
+ * @return The number of bytes written, 0 if the buffer is too small or the
+ * vector is in flat mode.
+ */
+mut_usz vec_svecs_write_buffer(vec self, void *buffer, usz size);
+
+/**
+ * @brief Writes the records of a vector of svecs to a file descriptor.
+ *
+ * @param self The vector.
+ * @param fd The file descriptor.
+ * @return True on success, false on a write error or if the vector is in
+ * flat mode.
+ */
+bool vec_svecs_write(vec self, int fd);
+
+/**
+ * @brief Reads a vector of svecs from a file descriptor.
+ *
+ * @param fd The file descriptor.
+ * @param size The size of each element of the rows.
+ * @param interface The interface of the new vector, whose `destroy` frees
+ * the rows (free or svec_destroy).
+ * @return Returns a new vector, NULL on a read error or invalid record.
+ */
+mut_vec _vec_svecs_read(int fd, usz size, vec_interface interface);
+
+/**
+ * @brief Copies a vector of svecs out of a buffer.
+ *
+ * @param buffer The buffer.
+ * @param size The size of the buffer.
+ * @param type_size The size of each element of the rows.
+ * @param interface The interface of the new vector.
+ * @param used Receives the size of the records, may be NULL.
+ * @return Returns a new vector, NULL if a record is invalid.
+ */
+mut_vec _vec_svecs_read_buffer(void const *buffer, usz size, usz type_size,
+                               vec_interface interface, mut_usz *used);
+
+/**
+ * @brief Builds a vector of svecs used in place in a buffer.
+ *
+ * Each row is made by svec_from_buffer, so only the vector itself is
+ * allocated. The rows have to be freed with svec_destroy.
+ *
+ * @param buffer The buffer.
+ * @param size The size of the buffer.
+ * @param type_size The size of each element of the rows.
+ * @param interface The interface of the new vector, whose `destroy` must be
+ * svec_destroy or NULL.
+ * @param used Receives the size of the records, may be NULL.
+ * @return Returns a new vector, NULL if a record is invalid.
+ */
+mut_vec _vec_svecs_from_buffer(void *buffer, usz size, usz type_size,
+                               vec_interface interface, mut_usz *used);
+
+/**
+ * @brief Macro for reading a vector of svecs from a file descriptor.
+ *
+ * @param FD The file descriptor.
+ * @param TYPE The type of each element of the rows.
+ * @param INTERFACE The interface of the new vector.
+ */
+#define vec_svecs_read(FD, TYPE, INTERFACE)                                    \
+  _vec_svecs_read((FD), sizeof(TYPE), (INTERFACE))
+
+/**
+ * @brief Macro for copying a vector of svecs out of a buffer.
+ *
+ * @param BUFFER The buffer.
+ * @param SIZE The size of the buffer.
+ * @param TYPE The type of each element of the rows.
+ * @param INTERFACE The interface of the new vector.
+ * @param USED Receives the size of the records, may be NULL.
+ */
+#define vec_svecs_read_buffer(BUFFER, SIZE, TYPE, INTERFACE, USED)             \
+  _vec_svecs_read_buffer((BUFFER), (SIZE), sizeof(TYPE), (INTERFACE), (USED))
+
+/**
+ * @brief Macro for building a vector of svecs used in place in a buffer.
+ *
+ * @param BUFFER The buffer.
+ * @param SIZE The size of the buffer.
+ * @param TYPE The type of each element of the rows.
+ * @param INTERFACE The interface of the new vector.
+ * @param USED Receives the size of the records, may be NULL.
+ */
+#define vec_svecs_from_buffer(BUFFER, SIZE, TYPE, INTERFACE, USED)             \
+  _vec_svecs_from_buffer((BUFFER), (SIZE), sizeof(TYPE), (INTERFACE), (USED))
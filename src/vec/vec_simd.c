@@ -0,0 +1,225 @@
+#include "vec_simd.h"
+#include "wtfc.h"
+#include <stdatomic.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VEC_SIMD_X86 1
+#endif
+
+/**
+ * @brief Number of independent accumulators used by reductions.
+ *
+ * Splitting a reduction into lanes lets the compiler keep them in one SIMD
+ * register without reordering floating point operations.
+ */
+#define VEC_SIMD_LANES 16
+
+/*
+  types as X(name, elementwise type, accumulator type, accumulation type),
+  integer arithmetic is done in unsigned types so that it wraps around
+*/
+#define SIMD_TYPES(X)                                                          \
+  X(i8, mut_u32, mut_i64, mut_u64)                                             \
+  X(i16, mut_u32, mut_i64, mut_u64)                                            \
+  X(i32, mut_u32, mut_i64, mut_u64)                                            \
+  X(i64, mut_u64, mut_i64, mut_u64)                                            \
+  X(f32, mut_f32, mut_f32, mut_f32)                                            \
+  X(f64, mut_f64, mut_f64, mut_f64)
+
+static atomic_int detected_level = -1;
+
+/**
+ * @brief Detects the best instruction set supported by the CPU.
+ *
+ * @return The instruction set.
+ */
+static enum vec_simd_level _detect(void) {
+#ifdef VEC_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+    return VEC_SIMD_AVX512;
+  }
+
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return VEC_SIMD_AVX2;
+  }
+#endif
+  return VEC_SIMD_SCALAR;
+}
+
+enum vec_simd_level vec_simd_level(void) {
+  int level = atomic_load_explicit(&detected_level, memory_order_relaxed);
+  if (level < 0) {
+    level = (int)_detect();
+    atomic_store_explicit(&detected_level, level, memory_order_relaxed);
+  }
+
+  return (enum vec_simd_level)level;
+}
+
+void vec_simd_set_level(enum vec_simd_level level) {
+  enum vec_simd_level supported = _detect();
+  atomic_store_explicit(&detected_level,
+                        (int)(level < supported ? level : supported),
+                        memory_order_relaxed);
+}
+
+/*
+  every kernel is compiled once per instruction set from the same body and
+  the public function dispatches on the detected level, RETURN is `return`
+  for kernels returning a value and empty otherwise
+*/
+#ifdef VEC_SIMD_X86
+#define SIMD_VARIANTS(NAME, RET, PARAMS, ARGS, RETURN, BODY)                   \
+  static RET NAME##_scalar PARAMS BODY                                         \
+  __attribute__((target("avx2,fma"))) static RET NAME##_avx2 PARAMS BODY       \
+  __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"))) static RET     \
+  NAME##_avx512 PARAMS BODY                                                    \
+  RET NAME PARAMS {                                                            \
+    RET(*impl) PARAMS = NAME##_scalar;                                         \
+    switch (vec_simd_level()) {                                                \
+    case VEC_SIMD_AVX512:                                                      \
+      impl = NAME##_avx512;                                                    \
+      break;                                                                   \
+    case VEC_SIMD_AVX2:                                                        \
+      impl = NAME##_avx2;                                                      \
+      break;                                                                   \
+    case VEC_SIMD_SCALAR:                                                      \
+      break;                                                                   \
+    }                                                                          \
+    RETURN impl ARGS;                                                          \
+  }
+#else
+#define SIMD_VARIANTS(NAME, RET, PARAMS, ARGS, RETURN, BODY)                   \
+  RET NAME PARAMS BODY
+#endif
+
+// kernel bodies
+#define BODY_ADD(T, W)                                                         \
+  {                                                                            \
+    for (mut_usz i = 0; i < n; ++i) {                                          \
+      dst[i] = (mut_##T)((W)a[i] + (W)b[i]);                                   \
+    }                                                                          \
+  }
+
+#define BODY_MUL(T, W)                                                         \
+  {                                                                            \
+    for (mut_usz i = 0; i < n; ++i) {                                          \
+      dst[i] = (mut_##T)((W)a[i] * (W)b[i]);                                   \
+    }                                                                          \
+  }
+
+#define BODY_FMA(T, W)                                                         \
+  {                                                                            \
+    for (mut_usz i = 0; i < n; ++i) {                                          \
+      dst[i] = (mut_##T)((W)a[i] * (W)b[i] + (W)c[i]);                         \
+    }                                                                          \
+  }
+
+#define BODY_SCALE(T, W)                                                       \
+  {                                                                            \
+    W factor = (W)k;                                                           \
+    for (mut_usz i = 0; i < n; ++i) {                                          \
+      dst[i] = (mut_##T)((W)a[i] * factor);                                    \
+    }                                                                          \
+  }
+
+#define BODY_AXPY(T, W)                                                        \
+  {                                                                            \
+    W factor = (W)k;                                                           \
+    for (mut_usz i = 0; i < n; ++i) {                                          \
+      dst[i] = (mut_##T)((W)dst[i] + (W)a[i] * factor);                        \
+    }                                                                          \
+  }
+
+#define BODY_REDUCE(ACC, ACCW, TERM)                                           \
+  {                                                                            \
+    ACCW lanes[VEC_SIMD_LANES] = {0};                                          \
+    mut_usz i = 0;                                                             \
+    for (; i + VEC_SIMD_LANES <= n; i += VEC_SIMD_LANES) {                     \
+      for (mut_usz l = 0; l < VEC_SIMD_LANES; ++l) {                           \
+        lanes[l] += TERM(i + l);                                               \
+      }                                                                        \
+    }                                                                          \
+    ACCW total = 0;                                                            \
+    for (mut_usz l = 0; l < VEC_SIMD_LANES; ++l) {                             \
+      total += lanes[l];                                                       \
+    }                                                                          \
+    for (; i < n; ++i) {                                                       \
+      total += TERM(i);                                                        \
+    }                                                                          \
+    return (ACC)total;                                                         \
+  }
+
+#define BODY_PICK(T, BETTER)                                                   \
+  {                                                                            \
+    mut_##T lanes[VEC_SIMD_LANES];                                             \
+    for (mut_usz l = 0; l < VEC_SIMD_LANES; ++l) {                             \
+      lanes[l] = a[0];                                                         \
+    }                                                                          \
+    mut_usz i = 0;                                                             \
+    for (; i + VEC_SIMD_LANES <= n; i += VEC_SIMD_LANES) {                     \
+      for (mut_usz l = 0; l < VEC_SIMD_LANES; ++l) {                           \
+        lanes[l] = a[i + l] BETTER lanes[l] ? a[i + l] : lanes[l];             \
+      }                                                                        \
+    }                                                                          \
+    mut_##T best = lanes[0];                                                   \
+    for (mut_usz l = 1; l < VEC_SIMD_LANES; ++l) {                             \
+      best = lanes[l] BETTER best ? lanes[l] : best;                           \
+    }                                                                          \
+    for (; i < n; ++i) {                                                       \
+      best = a[i] BETTER best ? a[i] : best;                                   \
+    }                                                                          \
+    return best;                                                               \
+  }
+
+#define BODY_CMPGT                                                             \
+  {                                                                            \
+    for (mut_usz i = 0; i < n; ++i) {                                          \
+      mask[i] = (mut_u8)(a[i] > b[i]);                                         \
+    }                                                                          \
+  }
+
+#define SIMD_DEFINE(T, W, ACC, ACCW)                                           \
+  SIMD_VARIANTS(vec_simd_add_##T, void,                                        \
+                (mut_##T * dst, T * a, T * b, usz n), (dst, a, b, n), ,        \
+                BODY_ADD(T, W))                                                \
+  SIMD_VARIANTS(vec_simd_mul_##T, void,                                        \
+                (mut_##T * dst, T * a, T * b, usz n), (dst, a, b, n), ,        \
+                BODY_MUL(T, W))                                                \
+  SIMD_VARIANTS(vec_simd_fma_##T, void,                                        \
+                (mut_##T * dst, T * a, T * b, T * c, usz n),                   \
+                (dst, a, b, c, n), , BODY_FMA(T, W))                           \
+  SIMD_VARIANTS(vec_simd_scale_##T, void, (mut_##T * dst, T * a, T k, usz n), \
+                (dst, a, k, n), , BODY_SCALE(T, W))                            \
+  SIMD_VARIANTS(vec_simd_axpy_##T, void, (mut_##T * dst, T * a, T k, usz n),  \
+                (dst, a, k, n), , BODY_AXPY(T, W))                             \
+  SIMD_VARIANTS(vec_simd_sum_##T, ACC, (T * a, usz n), (a, n), return,         \
+                BODY_REDUCE(ACC, ACCW, SUM_TERM_##T))                          \
+  SIMD_VARIANTS(vec_simd_min_##T, mut_##T, (T * a, usz n), (a, n), return,     \
+                BODY_PICK(T, <))                                               \
+  SIMD_VARIANTS(vec_simd_max_##T, mut_##T, (T * a, usz n), (a, n), return,     \
+                BODY_PICK(T, >))                                               \
+  SIMD_VARIANTS(vec_simd_dot_##T, ACC, (T * a, T * b, usz n), (a, b, n),       \
+                return, BODY_REDUCE(ACC, ACCW, DOT_TERM_##T))                  \
+  SIMD_VARIANTS(vec_simd_cmpgt_##T, void,                                      \
+                (mut_u8 * mask, T * a, T * b, usz n), (mask, a, b, n), ,       \
+                BODY_CMPGT)
+
+// terms of the reductions, converted to the accumulation type
+#define SUM_TERM_i8(I) ((mut_u64)a[I])
+#define SUM_TERM_i16(I) ((mut_u64)a[I])
+#define SUM_TERM_i32(I) ((mut_u64)a[I])
+#define SUM_TERM_i64(I) ((mut_u64)a[I])
+#define SUM_TERM_f32(I) (a[I])
+#define SUM_TERM_f64(I) (a[I])
+
+#define DOT_TERM_i8(I) ((mut_u64)a[I] * (mut_u64)b[I])
+#define DOT_TERM_i16(I) ((mut_u64)a[I] * (mut_u64)b[I])
+#define DOT_TERM_i32(I) ((mut_u64)a[I] * (mut_u64)b[I])
+#define DOT_TERM_i64(I) ((mut_u64)a[I] * (mut_u64)b[I])
+#define DOT_TERM_f32(I) (a[I] * b[I])
+#define DOT_TERM_f64(I) (a[I] * b[I])
+
+SIMD_TYPES(SIMD_DEFINE)
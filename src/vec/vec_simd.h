@@ -0,0 +1,154 @@
+/**
+ * @file vec_simd.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Vectorized numeric kernels for arrays and svecs of primitive types
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ * Every kernel exists for i8, i16, i32, i64, f32 and f64, named
+ * `vec_simd_<op>_<type>`. Each one is compiled for AVX-512, AVX2 and the
+ * baseline instruction set (SSE2 on x86-64), and the best variant supported
+ * by the CPU is picked at run time. Integer arithmetic wraps around like the
+ * hardware does, sums and dot products of integers are accumulated in 64
+ * bits. Output arrays may alias input arrays.
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @enum  vec_simd_level
+ * @brief Instruction set used by the kernels.
+ */
+enum vec_simd_level {
+  VEC_SIMD_SCALAR, /**< Baseline instruction set of the build. */
+  VEC_SIMD_AVX2,   /**< AVX2 and FMA. */
+  VEC_SIMD_AVX512, /**< AVX-512 F/BW/DQ/VL. */
+};
+
+/**
+ * @brief Returns the instruction set used by the kernels.
+ *
+ * Detected from the CPU on first use unless set with vec_simd_set_level.
+ *
+ * @return The instruction set.
+ */
+enum vec_simd_level vec_simd_level(void);
+
+/**
+ * @brief Forces the kernels to an instruction set.
+ *
+ * Levels not supported by the CPU are lowered to the best supported one.
+ *
+ * @param level The instruction set.
+ */
+void vec_simd_set_level(enum vec_simd_level level);
+
+/**
+ * @brief Lists the kernel types as X(name, accumulator type).
+ */
+#define VEC_SIMD_TYPES(X)                                                      \
+  X(i8, mut_i64)                                                               \
+  X(i16, mut_i64)                                                              \
+  X(i32, mut_i64)                                                              \
+  X(i64, mut_i64)                                                              \
+  X(f32, mut_f32)                                                              \
+  X(f64, mut_f64)
+
+/*
+  kernels, for each type T:
+
+  vec_simd_add_T(dst, a, b, n)    dst[i] = a[i] + b[i]
+  vec_simd_mul_T(dst, a, b, n)    dst[i] = a[i] * b[i]
+  vec_simd_fma_T(dst, a, b, c, n) dst[i] = a[i] * b[i] + c[i]
+  vec_simd_scale_T(dst, a, k, n)  dst[i] = a[i] * k
+  vec_simd_axpy_T(dst, a, k, n)   dst[i] += a[i] * k
+  vec_simd_sum_T(a, n)            sum of a[i]
+  vec_simd_min_T(a, n)            smallest a[i], n must not be 0
+  vec_simd_max_T(a, n)            largest a[i], n must not be 0
+  vec_simd_dot_T(a, b, n)         sum of a[i] * b[i]
+  vec_simd_cmpgt_T(mask, a, b, n) mask[i] = a[i] > b[i] ? 1 : 0
+*/
+
+#define VEC_SIMD_DECLARE(T, ACC)                                               \
+  void vec_simd_add_##T(mut_##T *dst, T *a, T *b, usz n);                      \
+  void vec_simd_mul_##T(mut_##T *dst, T *a, T *b, usz n);                      \
+  void vec_simd_fma_##T(mut_##T *dst, T *a, T *b, T *c, usz n);                \
+  void vec_simd_scale_##T(mut_##T *dst, T *a, T k, usz n);                     \
+  void vec_simd_axpy_##T(mut_##T *dst, T *a, T k, usz n);                      \
+  ACC vec_simd_sum_##T(T *a, usz n);                                           \
+  mut_##T vec_simd_min_##T(T *a, usz n);                                       \
+  mut_##T vec_simd_max_##T(T *a, usz n);                                       \
+  ACC vec_simd_dot_##T(T *a, T *b, usz n);                                     \
+  void vec_simd_cmpgt_##T(mut_u8 *mask, T *a, T *b, usz n);
+
+VEC_SIMD_TYPES(VEC_SIMD_DECLARE)
+
+/*
+  svec wrappers, TYPE is one of the kernel types and the length of the
+  first source svec is used
+*/
+
+/**
+ * @brief Adds two svecs elementwise into DST.
+ */
+#define svec_add(TYPE, DST, A, B)                                              \
+  vec_simd_add_##TYPE(svec_data(DST), svec_data(A), svec_data(B),              \
+                      svec_length(A))
+
+/**
+ * @brief Multiplies two svecs elementwise into DST.
+ */
+#define svec_mul(TYPE, DST, A, B)                                              \
+  vec_simd_mul_##TYPE(svec_data(DST), svec_data(A), svec_data(B),              \
+                      svec_length(A))
+
+/**
+ * @brief Computes A * B + C elementwise into DST.
+ */
+#define svec_fma(TYPE, DST, A, B, C)                                           \
+  vec_simd_fma_##TYPE(svec_data(DST), svec_data(A), svec_data(B),              \
+                      svec_data(C), svec_length(A))
+
+/**
+ * @brief Multiplies every element of A by K into DST.
+ */
+#define svec_scale(TYPE, DST, A, K)                                            \
+  vec_simd_scale_##TYPE(svec_data(DST), svec_data(A), (K), svec_length(A))
+
+/**
+ * @brief Adds every element of A multiplied by K to DST.
+ */
+#define svec_axpy(TYPE, DST, A, K)                                             \
+  vec_simd_axpy_##TYPE(svec_data(DST), svec_data(A), (K), svec_length(A))
+
+/**
+ * @brief Returns the sum of the elements of A.
+ */
+#define svec_sum(TYPE, A) vec_simd_sum_##TYPE(svec_data(A), svec_length(A))
+
+/**
+ * @brief Returns the smallest element of a non-empty A.
+ */
+#define svec_min(TYPE, A) vec_simd_min_##TYPE(svec_data(A), svec_length(A))
+
+/**
+ * @brief Returns the largest element of a non-empty A.
+ */
+#define svec_max(TYPE, A) vec_simd_max_##TYPE(svec_data(A), svec_length(A))
+
+/**
+ * @brief Returns the dot product of A and B.
+ */
+#define svec_dot(TYPE, A, B)                                                   \
+  vec_simd_dot_##TYPE(svec_data(A), svec_data(B), svec_length(A))
+
+/**
+ * @brief Writes 1 to MASK where A is greater than B, 0 elsewhere.
+ */
+#define svec_cmpgt(TYPE, MASK, A, B)                                           \
+  vec_simd_cmpgt_##TYPE((MASK), svec_data(A), svec_data(B), svec_length(A))
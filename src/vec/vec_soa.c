@@ -0,0 +1,203 @@
+#include "vec_soa.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+
+/**
+ * @struct vec_soa
+ * @brief A vector of records, followed by its schema and column pointers.
+ */
+struct vec_soa {
+  mut_usz length;               /**< The number of records. */
+  mut_usz record_size;          /**< The size of a record. */
+  mut_usz fields;               /**< The number of fields. */
+  vec_allocator *allocator;     /**< The allocator, NULL for malloc. */
+  struct vec_soa_field *schema; /**< The fields. */
+  void **columns;               /**< One svec per field. */
+};
+
+/**
+ * @brief Returns the size of the block holding a vector and its schema.
+ */
+static mut_usz _soa_size(usz fields) {
+  return sizeof(struct vec_soa) +
+         fields * (sizeof(struct vec_soa_field) + sizeof(void *));
+}
+
+static unsigned char *_values(struct vec_soa const *self, usz field) {
+  return (unsigned char *)((struct _svec_mdi *)self->columns[field] + 1);
+}
+
+struct vec_soa *vec_soa_init(usz record_size,
+                             struct vec_soa_field const *schema, usz fields) {
+  return vec_soa_init_with(record_size, schema, fields, NULL);
+}
+
+struct vec_soa *vec_soa_init_with(usz record_size,
+                                  struct vec_soa_field const *schema,
+                                  usz fields, vec_allocator *allocator) {
+  for (mut_usz i = 0; i < fields; ++i) {
+    struct vec_soa_field const *field = &schema[i];
+    if (field->offset > record_size ||
+        field->size > record_size - field->offset || field->align == 0 ||
+        (field->align & (field->align - 1)) != 0 ||
+        field->align > _Alignof(max_align_t)) {
+      return NULL;
+    }
+  }
+
+  if (fields > (USZ_MAX - sizeof(struct vec_soa)) /
+                   (sizeof(struct vec_soa_field) + sizeof(void *))) {
+    OUT_OF_MEMORY;
+  }
+
+  struct vec_soa *self = _vec_allocate(allocator, _soa_size(fields));
+  self->length = 0;
+  self->record_size = record_size;
+  self->fields = fields;
+  self->allocator = allocator;
+  self->schema = (struct vec_soa_field *)(void *)(self + 1);
+  self->columns = (void **)(void *)(self->schema + fields);
+  if (fields != 0) {
+    memcpy(self->schema, schema, fields * sizeof *schema);
+  }
+
+  for (mut_usz i = 0; i < fields; ++i) {
+    self->columns[i] = _svec_with_capacity(schema[i].size,
+                                           VEC_INITIAL_ALLOC_SIZE, allocator);
+  }
+
+  return self;
+}
+
+void vec_soa_destroy(struct vec_soa *self) {
+  if (self == NULL) {
+    return;
+  }
+
+  for (mut_usz i = 0; i < self->fields; ++i) {
+    svec_destroy(self->columns[i]);
+  }
+
+  _vec_release(self->allocator, self, _soa_size(self->fields));
+}
+
+mut_usz vec_soa_length(struct vec_soa const *self) { return self->length; }
+
+mut_usz vec_soa_fields(struct vec_soa const *self) { return self->fields; }
+
+void vec_soa_reserve(struct vec_soa *self, usz capacity) {
+  for (mut_usz i = 0; i < self->fields; ++i) {
+    self->columns[i] = _svec_reserve(self->columns[i], capacity);
+  }
+}
+
+void vec_soa_push(struct vec_soa *self, void const *record) {
+  vec_soa_extend(self, record, 1);
+}
+
+void vec_soa_extend(struct vec_soa *self, void const *records, usz count) {
+  if (count == 0) {
+    return;
+  }
+
+  if (count > USZ_MAX - self->length) {
+    OUT_OF_MEMORY;
+  }
+
+  // fill one column at a time, so each pass writes a single array
+  unsigned char const *bytes = records;
+  for (mut_usz i = 0; i < self->fields; ++i) {
+    struct vec_soa_field const *field = &self->schema[i];
+    if (svec_capacity(self->columns[i]) - self->length < count) {
+      usz doubled = self->length > USZ_MAX / 2 ? USZ_MAX : self->length * 2;
+      self->columns[i] =
+          _svec_reserve(self->columns[i], doubled > self->length + count
+                                              ? doubled
+                                              : self->length + count);
+    }
+
+    unsigned char *values = _values(self, i) + self->length * field->size;
+    unsigned char const *source = bytes + field->offset;
+    for (mut_usz j = 0; j < count; ++j) {
+      memcpy(values + j * field->size, source + j * self->record_size,
+             field->size);
+    }
+    svec_length(self->columns[i]) += count;
+  }
+
+  self->length += count;
+  VEC_STAT(_vec_stats_push(NULL, count));
+}
+
+bool vec_soa_get(struct vec_soa const *self, usz index, void *record) {
+  if (index >= self->length) {
+    return false;
+  }
+
+  unsigned char *bytes = record;
+  for (mut_usz i = 0; i < self->fields; ++i) {
+    usz size = self->schema[i].size;
+    memcpy(bytes + self->schema[i].offset, _values(self, i) + index * size,
+           size);
+  }
+
+  return true;
+}
+
+bool vec_soa_set(struct vec_soa *self, usz index, void const *record) {
+  if (index >= self->length) {
+    return false;
+  }
+
+  unsigned char const *bytes = record;
+  for (mut_usz i = 0; i < self->fields; ++i) {
+    usz size = self->schema[i].size;
+    memcpy(_values(self, i) + index * size, bytes + self->schema[i].offset,
+           size);
+  }
+
+  return true;
+}
+
+bool vec_soa_pop(struct vec_soa *self) {
+  if (self->length == 0) {
+    return false;
+  }
+
+  for (mut_usz i = 0; i < self->fields; ++i) {
+    svec_length(self->columns[i]) -= 1;
+  }
+
+  self->length -= 1;
+  return true;
+}
+
+bool vec_soa_find(struct vec_soa const *self, char const *name,
+                  mut_usz *field) {
+  for (mut_usz i = 0; i < self->fields; ++i) {
+    if (strcmp(self->schema[i].name, name) == 0) {
+      *field = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void *vec_soa_column(struct vec_soa const *self, usz field) {
+  return field < self->fields ? _values(self, field) : NULL;
+}
+
+void vec_soa_foreach_column(struct vec_soa const *self, usz field,
+                            void (*apply)(void *ctx, vec_item item),
+                            void *ctx) {
+  if (field >= self->fields) {
+    return;
+  }
+
+  unsigned char *values = _values(self, field);
+  usz size = self->schema[field].size;
+  for (mut_usz i = 0; i < self->length; ++i) {
+    apply(ctx, values + i * size);
+  }
+}
@@ -0,0 +1,195 @@
+/**
+ * @file vec_soa.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Structure-of-arrays vector of records
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+#include <stddef.h>
+
+/**
+ * @struct  vec_soa_field
+ * @brief A field of the records stored by a vec_soa.
+ */
+struct vec_soa_field {
+  char const *name; /**< The name of the field, not copied. */
+  mut_usz offset;   /**< The offset of the field in a record. */
+  mut_usz size;     /**< The size of the field. */
+  mut_usz align;    /**< The alignment of the field. */
+};
+
+/**
+ * @struct  vec_soa
+ * @brief A vector of records keeping one contiguous column per field.
+ *
+ * Each column is an svec of its field, so scanning a field reads only that
+ * field, and a column can be handed to a vectorized loop as a plain array.
+ * Records are pushed and read back as structs laid out as in the schema.
+ * Columns are aligned like max_align_t, which bounds the field alignment.
+ */
+struct vec_soa;
+
+/**
+ * @brief Describes a member of a struct as a field.
+ *
+ * @param STRUCT The type of the records.
+ * @param MEMBER The member.
+ * @param TYPE The type of the member, as in wtfc.h.
+ */
+#define VEC_SOA_FIELD(STRUCT, MEMBER, TYPE)                                    \
+  {#MEMBER, offsetof(STRUCT, MEMBER), sizeof(TYPE), _Alignof(TYPE)}
+
+/**
+ * @brief Initializes a vector of records using malloc.
+ *
+ * @param record_size The size of a record.
+ * @param schema The fields, copied.
+ * @param fields The number of fields.
+ * @return Returns a new vector, NULL if a field does not fit in a record or
+ * has an invalid alignment.
+ */
+struct vec_soa *vec_soa_init(usz record_size,
+                             struct vec_soa_field const *schema, usz fields);
+
+/**
+ * @brief Initializes a vector of records using a custom allocator.
+ *
+ * @param record_size The size of a record.
+ * @param schema The fields, copied.
+ * @param fields The number of fields.
+ * @param allocator The allocator for the vector and its columns, NULL for
+ * malloc.
+ * @return Returns a new vector, NULL if a field does not fit in a record or
+ * has an invalid alignment.
+ */
+struct vec_soa *vec_soa_init_with(usz record_size,
+                                  struct vec_soa_field const *schema,
+                                  usz fields, vec_allocator *allocator);
+
+/**
+ * @brief Macro for initializing a vector of records from a schema array.
+ *
+ * @param STRUCT The type of the records.
+ * @param SCHEMA An array of struct vec_soa_field.
+ */
+#define vec_soa_init_for(STRUCT, SCHEMA)                                       \
+  vec_soa_init(sizeof(STRUCT), (SCHEMA), sizeof(SCHEMA) / sizeof *(SCHEMA))
+
+/**
+ * @brief Frees a vector of records and its columns.
+ *
+ * @param self The vector, may be NULL.
+ */
+void vec_soa_destroy(struct vec_soa *self);
+
+/**
+ * @brief Get the number of records.
+ *
+ * @param self The vector.
+ * @return The number of records.
+ */
+mut_usz vec_soa_length(struct vec_soa const *self);
+
+/**
+ * @brief Get the number of fields.
+ *
+ * @param self The vector.
+ * @return The number of fields.
+ */
+mut_usz vec_soa_fields(struct vec_soa const *self);
+
+/**
+ * @brief Makes room in every column for at least `capacity` records.
+ *
+ * @param self The vector.
+ * @param capacity The number of records.
+ */
+void vec_soa_reserve(struct vec_soa *self, usz capacity);
+
+/**
+ * @brief Adds a record at the end, scattering its fields into the columns.
+ *
+ * @param self The vector.
+ * @param record The address of the record.
+ */
+void vec_soa_push(struct vec_soa *self, void const *record);
+
+/**
+ * @brief Adds consecutive records at the end, one column at a time.
+ *
+ * @param self The vector.
+ * @param records The records.
+ * @param count The number of records.
+ */
+void vec_soa_extend(struct vec_soa *self, void const *records, usz count);
+
+/**
+ * @brief Gathers the fields of a record into a struct.
+ *
+ * Bytes of the struct that are not covered by a field are left alone.
+ *
+ * @param self The vector.
+ * @param index The index of the record.
+ * @param record Receives the record.
+ * @return True if the record was read, false if the index is invalid.
+ */
+bool vec_soa_get(struct vec_soa const *self, usz index, void *record);
+
+/**
+ * @brief Overwrites the fields of a record.
+ *
+ * @param self The vector.
+ * @param index The index of the record.
+ * @param record The address of the new record.
+ * @return True if the record was written, false if the index is invalid.
+ */
+bool vec_soa_set(struct vec_soa *self, usz index, void const *record);
+
+/**
+ * @brief Removes the last record.
+ *
+ * @param self The vector.
+ * @return True if a record was removed, false if the vector is empty.
+ */
+bool vec_soa_pop(struct vec_soa *self);
+
+/**
+ * @brief Finds a field by name.
+ *
+ * @param self The vector.
+ * @param name The name of the field.
+ * @param field Receives the index of the field.
+ * @return True if the field exists, false otherwise.
+ */
+bool vec_soa_find(struct vec_soa const *self, char const *name,
+                  mut_usz *field);
+
+/**
+ * @brief Returns the column of a field, holding one value per record.
+ *
+ * The address stays valid until the vector grows.
+ *
+ * @param self The vector.
+ * @param field The index of the field.
+ * @return The first value of the column, NULL if the field is invalid.
+ */
+void *vec_soa_column(struct vec_soa const *self, usz field);
+
+/**
+ * @brief Applies a function taking a context to each value of a column.
+ *
+ * @param self The vector.
+ * @param field The index of the field.
+ * @param apply The function to apply to each value.
+ * @param ctx The context passed to `apply`.
+ */
+void vec_soa_foreach_column(struct vec_soa const *self, usz field,
+                            void (*apply)(void *ctx, vec_item item),
+                            void *ctx);
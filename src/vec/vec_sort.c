@@ -0,0 +1,1011 @@
+#include "vec_sort.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Ranges at most this long are finished with insertion sort.
+ */
+#define VEC_SORT_INSERTION 16
+
+/**
+ * @brief Numeric arrays at most this long are sorted by comparing keys.
+ *
+ * Below it the histograms of a radix sort cost more than the sort itself.
+ */
+#define VEC_SORT_RADIX_MIN 1536
+
+/**
+ * @struct _sorter
+ * @brief An array of items being sorted or searched.
+ */
+struct _sorter {
+  char *base;                         /**< The first slot. */
+  mut_usz step;                       /**< The distance between slots. */
+  mut_usz size;                       /**< The size of a slot. */
+  bool indirect;                      /**< Slots hold item pointers. */
+  int (*cmp)(vec_item a, vec_item b); /**< The comparator. */
+  vec_allocator *allocator;           /**< Allocates temporary buffers. */
+};
+
+/**
+ * @brief Describes the element buffer of a vector.
+ *
+ * @param self The vector.
+ * @param cmp The comparator.
+ * @return The sorter.
+ */
+static struct _sorter _vec_sorter(vec self,
+                                  int (*cmp)(vec_item a, vec_item b)) {
+  return (struct _sorter){.base = self->elements,
+                          .step = self->stride * _slot_size(self),
+                          .size = _slot_size(self),
+                          .indirect = !self->interface.flat,
+                          .cmp = cmp,
+                          .allocator = self->interface.allocator};
+}
+
+/**
+ * @brief Describes the elements of an svec.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @param cmp The comparator.
+ * @return The sorter.
+ */
+static struct _sorter _svec_sorter(void *svec_ptr,
+                                   int (*cmp)(vec_item a, vec_item b)) {
+  struct _svec_mdi *data = svec_ptr;
+  return (struct _sorter){.base = (char *)(data + 1),
+                          .step = data->type_size,
+                          .size = data->type_size,
+                          .indirect = false,
+                          .cmp = cmp,
+                          .allocator = _svec_derived_allocator(data)};
+}
+
+static inline char *_elem(struct _sorter const *s, usz index) {
+  return s->base + index * s->step;
+}
+
+/**
+ * @brief Compares the items stored in two slots.
+ *
+ * @param s The sorter.
+ * @param a The first slot.
+ * @param b The second slot.
+ * @return The result of the comparator.
+ */
+static inline int _compare(struct _sorter const *s, void *a, void *b) {
+  if (s->indirect) {
+    return s->cmp(*(vec_item *)a, *(vec_item *)b);
+  }
+
+  return s->cmp(a, b);
+}
+
+static inline bool _less(struct _sorter const *s, usz a, usz b) {
+  return _compare(s, _elem(s, a), _elem(s, b)) < 0;
+}
+
+static inline void _swap(struct _sorter const *s, usz a, usz b) {
+  if (s->indirect) {
+    vec_item *x = (vec_item *)(void *)_elem(s, a);
+    vec_item *y = (vec_item *)(void *)_elem(s, b);
+    vec_item tmp = *x;
+    *x = *y;
+    *y = tmp;
+  } else {
+    _swap_bytes(_elem(s, a), _elem(s, b), s->size);
+  }
+}
+
+/**
+ * @brief Sorts [lo, hi) by insertion, stable.
+ */
+static void _insertion_sort(struct _sorter const *s, usz lo, usz hi) {
+  for (mut_usz i = lo + 1; i < hi; ++i) {
+    for (mut_usz j = i; j > lo && _less(s, j, j - 1); --j) {
+      _swap(s, j, j - 1);
+    }
+  }
+}
+
+static void _sift_down(struct _sorter const *s, usz lo, mut_usz root,
+                       usz count) {
+  for (;;) {
+    mut_usz child = 2 * root + 1;
+    if (child >= count) {
+      return;
+    }
+
+    if (child + 1 < count && _less(s, lo + child, lo + child + 1)) {
+      child += 1;
+    }
+
+    if (!_less(s, lo + root, lo + child)) {
+      return;
+    }
+
+    _swap(s, lo + root, lo + child);
+    root = child;
+  }
+}
+
+/**
+ * @brief Sorts [lo, hi) with heapsort, used when quicksort goes quadratic.
+ */
+static void _heap_sort(struct _sorter const *s, usz lo, usz hi) {
+  usz count = hi - lo;
+  for (mut_usz i = count / 2; i > 0; --i) {
+    _sift_down(s, lo, i - 1, count);
+  }
+
+  for (mut_usz end = count; end > 1; --end) {
+    _swap(s, lo, lo + end - 1);
+    _sift_down(s, lo, 0, end - 1);
+  }
+}
+
+/**
+ * @brief Partitions [lo, hi) around the median of its first, middle and last
+ * items.
+ *
+ * The median of three leaves items on both ends that stop the scans, so the
+ * inner loops need no bounds checks.
+ *
+ * @param s The sorter.
+ * @param lo The first index, the range holds at least three items.
+ * @param hi The index past the end.
+ * @return The final index of the pivot; items before it are not greater and
+ * items after it are not less.
+ */
+static mut_usz _partition(struct _sorter const *s, usz lo, usz hi) {
+  usz mid = lo + (hi - lo) / 2;
+  if (_less(s, mid, lo)) {
+    _swap(s, mid, lo);
+  }
+  if (_less(s, hi - 1, mid)) {
+    _swap(s, hi - 1, mid);
+    if (_less(s, mid, lo)) {
+      _swap(s, mid, lo);
+    }
+  }
+  _swap(s, lo, mid);
+
+  mut_usz i = lo;
+  mut_usz j = hi;
+  for (;;) {
+    do {
+      ++i;
+    } while (_less(s, i, lo));
+    do {
+      --j;
+    } while (_less(s, lo, j));
+
+    if (i >= j) {
+      break;
+    }
+    _swap(s, i, j);
+  }
+
+  _swap(s, lo, j);
+  return j;
+}
+
+/**
+ * @brief Returns the recursion depth after which introsort switches to
+ * heapsort, twice the binary logarithm of the length.
+ */
+static mut_usz _depth_limit(usz count) {
+  mut_usz depth = 0;
+  for (mut_usz n = count; n > 1; n >>= 1) {
+    depth += 2;
+  }
+  return depth;
+}
+
+static void _intro_sort(struct _sorter const *s, mut_usz lo, mut_usz hi,
+                        mut_usz depth) {
+  while (hi - lo > VEC_SORT_INSERTION) {
+    if (depth == 0) {
+      _heap_sort(s, lo, hi);
+      return;
+    }
+    depth -= 1;
+
+    // recurse into the smaller side to bound the stack
+    usz pivot = _partition(s, lo, hi);
+    if (pivot - lo < hi - pivot) {
+      _intro_sort(s, lo, pivot, depth);
+      lo = pivot + 1;
+    } else {
+      _intro_sort(s, pivot + 1, hi, depth);
+      hi = pivot;
+    }
+  }
+
+  _insertion_sort(s, lo, hi);
+}
+
+static void _sort(struct _sorter const *s, usz count) {
+  if (count > 1) {
+    _intro_sort(s, 0, count, _depth_limit(count));
+  }
+}
+
+/**
+ * @brief Merge sorts [lo, hi) through a temporary buffer of the same size.
+ */
+static void _merge_sort(struct _sorter const *s, char *tmp, usz lo, usz hi) {
+  if (hi - lo <= VEC_SORT_INSERTION) {
+    _insertion_sort(s, lo, hi);
+    return;
+  }
+
+  usz mid = lo + (hi - lo) / 2;
+  _merge_sort(s, tmp, lo, mid);
+  _merge_sort(s, tmp, mid, hi);
+  if (!_less(s, mid, mid - 1)) {
+    return;
+  }
+
+  // take from the right only when strictly less to keep the sort stable
+  mut_usz i = lo;
+  mut_usz j = mid;
+  char *out = tmp;
+  while (i < mid && j < hi) {
+    usz take = _less(s, j, i) ? j++ : i++;
+    memcpy(out, _elem(s, take), s->size);
+    out += s->size;
+  }
+  usz rest = (mid - i) * s->size;
+  memcpy(out, _elem(s, i), rest);
+  memcpy(_elem(s, lo), tmp, (usz)(out - tmp) + rest);
+}
+
+static void _stable_sort(struct _sorter const *s, usz count) {
+  if (count <= VEC_SORT_INSERTION) {
+    _insertion_sort(s, 0, count);
+    return;
+  }
+
+  char *tmp = _vec_allocate(s->allocator, count * s->size);
+  _merge_sort(s, tmp, 0, count);
+  _vec_release(s->allocator, tmp, count * s->size);
+}
+
+/**
+ * @brief Finds the first item not less than (or, with `upper`, greater than)
+ * a key.
+ */
+static mut_usz _bound(struct _sorter const *s, usz count, vec_item key,
+                      bool upper) {
+  mut_usz lo = 0;
+  mut_usz len = count;
+  while (len > 0) {
+    usz half = len / 2;
+    char *slot = _elem(s, lo + half);
+    vec_item item = s->indirect ? *(vec_item *)(void *)slot : slot;
+    int order = s->cmp(item, key);
+    if (upper ? order <= 0 : order < 0) {
+      lo += half + 1;
+      len -= half + 1;
+    } else {
+      len = half;
+    }
+  }
+  return lo;
+}
+
+void vec_sort(mut_vec self, int (*cmp)(vec_item a, vec_item b)) {
+  _vec_unshare(self);
+  struct _sorter s = _vec_sorter(self, cmp);
+  _sort(&s, self->length);
+}
+
+void vec_stable_sort(mut_vec self, int (*cmp)(vec_item a, vec_item b)) {
+  _vec_unshare(self);
+  struct _sorter s = _vec_sorter(self, cmp);
+  _stable_sort(&s, self->length);
+}
+
+void vec_nth_element(mut_vec self, usz n, int (*cmp)(vec_item a, vec_item b)) {
+  if (n >= self->length) {
+    return;
+  }
+
+  _vec_unshare(self);
+  struct _sorter s = _vec_sorter(self, cmp);
+  mut_usz lo = 0;
+  mut_usz hi = self->length;
+  mut_usz depth = _depth_limit(hi);
+  while (hi - lo > VEC_SORT_INSERTION) {
+    if (depth == 0) {
+      _heap_sort(&s, lo, hi);
+      return;
+    }
+    depth -= 1;
+
+    usz pivot = _partition(&s, lo, hi);
+    if (pivot == n) {
+      return;
+    }
+    if (n < pivot) {
+      hi = pivot;
+    } else {
+      lo = pivot + 1;
+    }
+  }
+
+  _insertion_sort(&s, lo, hi);
+}
+
+mut_usz vec_lower_bound(vec self, vec_item key,
+                        int (*cmp)(vec_item a, vec_item b)) {
+  struct _sorter s = _vec_sorter(self, cmp);
+  return _bound(&s, self->length, key, false);
+}
+
+mut_usz vec_upper_bound(vec self, vec_item key,
+                        int (*cmp)(vec_item a, vec_item b)) {
+  struct _sorter s = _vec_sorter(self, cmp);
+  return _bound(&s, self->length, key, true);
+}
+
+bool vec_bsearch(vec self, vec_item key, int (*cmp)(vec_item a, vec_item b),
+                 mut_usz *index) {
+  usz found = vec_lower_bound(self, key, cmp);
+  if (found == self->length || cmp(_at(self, found), key) != 0) {
+    return false;
+  }
+
+  if (index != NULL) {
+    *index = found;
+  }
+  return true;
+}
+
+void _svec_sort(void *svec_ptr, int (*cmp)(vec_item a, vec_item b)) {
+  struct _sorter s = _svec_sorter(svec_ptr, cmp);
+  _sort(&s, ((struct _svec_mdi *)svec_ptr)->length);
+}
+
+void _svec_stable_sort(void *svec_ptr, int (*cmp)(vec_item a, vec_item b)) {
+  struct _sorter s = _svec_sorter(svec_ptr, cmp);
+  _stable_sort(&s, ((struct _svec_mdi *)svec_ptr)->length);
+}
+
+mut_usz _svec_lower_bound(void *svec_ptr, vec_item key,
+                          int (*cmp)(vec_item a, vec_item b)) {
+  struct _sorter s = _svec_sorter(svec_ptr, cmp);
+  return _bound(&s, ((struct _svec_mdi *)svec_ptr)->length, key, false);
+}
+
+// numeric sorts
+
+/*
+  keys are unsigned integers. Long arrays are sorted least significant digit
+  first, every pass scatters into the other buffer; all digit histograms are
+  counted in a single read of the data and a pass is skipped when one bucket
+  holds every key. Wide keys use 11-bit digits, which saves two of eight
+  passes over 64-bit keys while the counters still fit in the L2 cache.
+  Short arrays run the introsort above on the keys themselves, as clearing
+  and summing the counters would dominate. Keys are read and written with
+  memcpy as the arrays hold other types.
+*/
+#define RADIX_DEFINE(U, BITS)                                                  \
+  static inline mut_##U _load_##U(unsigned char const *data, usz i) {          \
+    mut_##U key;                                                               \
+    memcpy(&key, data + i * sizeof key, sizeof key);                           \
+    return key;                                                                \
+  }                                                                            \
+                                                                               \
+  static inline void _keep_##U(unsigned char *data, usz i, U key) {            \
+    memcpy(data + i * sizeof key, &key, sizeof key);                           \
+  }                                                                            \
+                                                                               \
+  static inline void _swap_##U(unsigned char *data, usz i, usz j) {            \
+    U key = _load_##U(data, i);                                                \
+    _keep_##U(data, i, _load_##U(data, j));                                    \
+    _keep_##U(data, j, key);                                                   \
+  }                                                                            \
+                                                                               \
+  static void _sift_keys_##U(unsigned char *data, usz lo, mut_usz root,        \
+                             usz n) {                                          \
+    for (;;) {                                                                 \
+      mut_usz child = 2 * root + 1;                                            \
+      if (child >= n) {                                                        \
+        return;                                                                \
+      }                                                                        \
+      if (child + 1 < n &&                                                     \
+          _load_##U(data, lo + child) < _load_##U(data, lo + child + 1)) {     \
+        child += 1;                                                            \
+      }                                                                        \
+      if (_load_##U(data, lo + child) <= _load_##U(data, lo + root)) {        \
+        return;                                                                \
+      }                                                                        \
+      _swap_##U(data, lo + root, lo + child);                                  \
+      root = child;                                                            \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void _intro_keys_##U(unsigned char *data, mut_usz lo, mut_usz hi,     \
+                              mut_usz depth) {                                 \
+    while (hi - lo > VEC_SORT_INSERTION) {                                     \
+      if (depth == 0) {                                                        \
+        usz n = hi - lo;                                                       \
+        for (mut_usz i = n / 2; i > 0; --i) {                                  \
+          _sift_keys_##U(data, lo, i - 1, n);                                  \
+        }                                                                      \
+        for (mut_usz i = n - 1; i > 0; --i) {                                  \
+          _swap_##U(data, lo, lo + i);                                         \
+          _sift_keys_##U(data, lo, 0, i);                                      \
+        }                                                                      \
+        return;                                                                \
+      }                                                                        \
+      depth -= 1;                                                              \
+                                                                               \
+      usz mid = lo + (hi - lo) / 2;                                            \
+      if (_load_##U(data, mid) < _load_##U(data, lo)) {                        \
+        _swap_##U(data, mid, lo);                                              \
+      }                                                                        \
+      if (_load_##U(data, hi - 1) < _load_##U(data, mid)) {                    \
+        _swap_##U(data, hi - 1, mid);                                          \
+        if (_load_##U(data, mid) < _load_##U(data, lo)) {                      \
+          _swap_##U(data, mid, lo);                                            \
+        }                                                                      \
+      }                                                                        \
+      _swap_##U(data, lo, mid);                                                \
+                                                                               \
+      U pivot = _load_##U(data, lo);                                           \
+      mut_usz i = lo;                                                          \
+      mut_usz j = hi;                                                          \
+      for (;;) {                                                               \
+        do {                                                                   \
+          ++i;                                                                 \
+        } while (_load_##U(data, i) < pivot);                                  \
+        do {                                                                   \
+          --j;                                                                 \
+        } while (pivot < _load_##U(data, j));                                  \
+        if (i >= j) {                                                          \
+          break;                                                               \
+        }                                                                      \
+        _swap_##U(data, i, j);                                                 \
+      }                                                                        \
+      _swap_##U(data, lo, j);                                                  \
+                                                                               \
+      if (j - lo < hi - j) {                                                   \
+        _intro_keys_##U(data, lo, j, depth);                                   \
+        lo = j + 1;                                                            \
+      } else {                                                                 \
+        _intro_keys_##U(data, j + 1, hi, depth);                               \
+        hi = j;                                                                \
+      }                                                                        \
+    }                                                                          \
+                                                                               \
+    for (mut_usz i = lo + 1; i < hi; ++i) {                                    \
+      U key = _load_##U(data, i);                                              \
+      mut_usz j = i;                                                           \
+      for (; j > lo && _load_##U(data, j - 1) > key; --j) {                    \
+        _keep_##U(data, j, _load_##U(data, j - 1));                            \
+      }                                                                        \
+      _keep_##U(data, j, key);                                                 \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void _sort_keys_##U(unsigned char *data, usz n,                       \
+                             vec_allocator *allocator) {                       \
+    enum {                                                                     \
+      PASSES = (8 * sizeof(U) + (BITS)-1) / (BITS),                            \
+      BUCKETS = 1 << (BITS),                                                   \
+    };                                                                         \
+    if (n <= VEC_SORT_RADIX_MIN) {                                             \
+      _intro_keys_##U(data, 0, n, _depth_limit(n));                            \
+      return;                                                                  \
+    }                                                                          \
+                                                                               \
+    usz counts_size = PASSES * sizeof(mut_usz[BUCKETS]);                      \
+    mut_usz(*counts)[BUCKETS] = _vec_allocate(allocator, counts_size);         \
+    unsigned char *tmp = _vec_allocate(allocator, n * sizeof(U));              \
+    memset(counts, 0, counts_size);                                            \
+                                                                               \
+    for (mut_usz i = 0; i < n; ++i) {                                          \
+      U key = _load_##U(data, i);                                              \
+      for (mut_usz p = 0; p < PASSES; ++p) {                                   \
+        counts[p][(key >> ((BITS)*p)) & (BUCKETS - 1)] += 1;                   \
+      }                                                                        \
+    }                                                                          \
+                                                                               \
+    unsigned char *src = data;                                                 \
+    unsigned char *dst = tmp;                                                  \
+    U first = _load_##U(data, 0);                                              \
+    for (mut_usz p = 0; p < PASSES; ++p) {                                     \
+      mut_usz *offsets = counts[p];                                            \
+      if (offsets[(first >> ((BITS)*p)) & (BUCKETS - 1)] == n) {               \
+        continue;                                                              \
+      }                                                                        \
+                                                                               \
+      mut_usz total = 0;                                                       \
+      for (mut_usz d = 0; d < BUCKETS; ++d) {                                  \
+        usz count = offsets[d];                                                \
+        offsets[d] = total;                                                    \
+        total += count;                                                        \
+      }                                                                        \
+      for (mut_usz i = 0; i < n; ++i) {                                        \
+        U key = _load_##U(src, i);                                             \
+        _keep_##U(dst, offsets[(key >> ((BITS)*p)) & (BUCKETS - 1)]++, key);   \
+      }                                                                        \
+                                                                               \
+      unsigned char *swap = src;                                               \
+      src = dst;                                                               \
+      dst = swap;                                                              \
+    }                                                                          \
+                                                                               \
+    if (src != data) {                                                         \
+      memcpy(data, src, n * sizeof(U));                                        \
+    }                                                                          \
+    _vec_release(allocator, tmp, n * sizeof(U));                               \
+    _vec_release(allocator, counts, counts_size);                              \
+  }
+
+RADIX_DEFINE(u8, 8)
+RADIX_DEFINE(u16, 8)
+RADIX_DEFINE(u32, 11)
+RADIX_DEFINE(u64, 11)
+
+/*
+  order-preserving mappings to unsigned keys: signed values flip the sign
+  bit, floating point values flip the sign bit when positive and every bit
+  when negative
+*/
+#define SIGN_BIT(U) ((mut_##U)((mut_##U)1 << (8 * sizeof(U) - 1)))
+#define KEY_SIGNED(U, V) ((mut_##U)((V) ^ SIGN_BIT(U)))
+#define VALUE_SIGNED(U, K) ((mut_##U)((K) ^ SIGN_BIT(U)))
+#define KEY_FLOAT(U, V)                                                        \
+  ((mut_##U)((V) & SIGN_BIT(U) ? ~(V) : (V) | SIGN_BIT(U)))
+#define VALUE_FLOAT(U, K)                                                      \
+  ((mut_##U)((K) & SIGN_BIT(U) ? (K) ^ SIGN_BIT(U) : ~(K)))
+
+#define SORT_ENTRY_DEFINE(T)                                                   \
+  void vec_sort_##T(mut_##T *data, usz n) {                                    \
+    vec_sort_##T##_with(data, n, NULL);                                        \
+  }                                                                            \
+                                                                               \
+  void _svec_sort_##T(void *svec_ptr) {                                        \
+    struct _svec_mdi *mdi = svec_ptr;                                          \
+    vec_sort_##T##_with((mut_##T *)(void *)(mdi + 1), mdi->length,             \
+                        _svec_derived_allocator(mdi));                         \
+  }
+
+#define SORT_NUM_DEFINE(T, U, KIND)                                            \
+  void vec_sort_##T##_with(mut_##T *data, usz n, vec_allocator *allocator) {   \
+    _Static_assert(sizeof(T) == sizeof(U), "key size mismatch");              \
+    unsigned char *bytes = (unsigned char *)data;                              \
+    for (mut_usz i = 0; i < n; ++i) {                                          \
+      U value = _load_##U(bytes, i);                                           \
+      _keep_##U(bytes, i, KEY_##KIND(U, value));                               \
+    }                                                                          \
+    _sort_keys_##U(bytes, n, allocator);                                       \
+    for (mut_usz i = 0; i < n; ++i) {                                          \
+      U key = _load_##U(bytes, i);                                             \
+      _keep_##U(bytes, i, VALUE_##KIND(U, key));                               \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  SORT_ENTRY_DEFINE(T)
+
+#define SORT_UNSIGNED_DEFINE(U)                                                \
+  void vec_sort_##U##_with(mut_##U *data, usz n, vec_allocator *allocator) {   \
+    _sort_keys_##U((unsigned char *)data, n, allocator);                       \
+  }                                                                            \
+                                                                               \
+  SORT_ENTRY_DEFINE(U)
+
+SORT_UNSIGNED_DEFINE(u8)
+SORT_UNSIGNED_DEFINE(u16)
+SORT_UNSIGNED_DEFINE(u32)
+SORT_UNSIGNED_DEFINE(u64)
+SORT_NUM_DEFINE(i8, u8, SIGNED)
+SORT_NUM_DEFINE(i16, u16, SIGNED)
+SORT_NUM_DEFINE(i32, u32, SIGNED)
+SORT_NUM_DEFINE(i64, u64, SIGNED)
+SORT_NUM_DEFINE(f32, u32, FLOAT)
+SORT_NUM_DEFINE(f64, u64, FLOAT)
+
+// parallel sorting
+
+/**
+ * @struct _par_sort
+ * @brief The state of a parallel sort shared by the loop bodies.
+ */
+struct _par_sort {
+  struct _sorter const *s;                              /**< The array. */
+  void (*sort_run)(struct _sorter const *s, usz count); /**< Sorts a run. */
+  mut_usz count;                                        /**< Its length. */
+  mut_usz width;   /**< The length of the runs being merged. */
+  char *src;       /**< The buffer holding the runs. */
+  char *dst;       /**< The buffer receiving the merged runs. */
+};
+
+static void _comparator_run(struct _sorter const *s, usz count) {
+  _sort(s, count);
+}
+
+static void _par_sort_runs(void *ctx, usz begin, usz end) {
+  struct _par_sort *par = ctx;
+  for (mut_usz run = begin; run < end; ++run) {
+    usz first = run * par->width;
+    usz last = first + par->width < par->count ? first + par->width
+                                               : par->count;
+    struct _sorter sub = *par->s;
+    sub.base = _elem(par->s, first);
+    // user allocators are not thread-safe, runs take their scratch from malloc
+    sub.allocator = NULL;
+    par->sort_run(&sub, last - first);
+  }
+}
+
+/**
+ * @brief Finds how many items of `a` come first among the first `d` items of
+ * the merge of `a` and `b`.
+ *
+ * Items of `a` go first on ties, as in the sequential merge.
+ *
+ * @param s The sorter, for its slot size and comparator.
+ * @param a The first run.
+ * @param m The length of the first run.
+ * @param b The second run.
+ * @param n The length of the second run.
+ * @param d The number of merged items.
+ * @return The number of items taken from `a`.
+ */
+static mut_usz _co_rank(struct _sorter const *s, char *a, usz m, char *b,
+                        usz n, usz d) {
+  mut_usz lo = d > n ? d - n : 0;
+  mut_usz hi = d < m ? d : m;
+  while (lo < hi) {
+    usz i = lo + (hi - lo + 1) / 2;
+    usz j = d - i;
+    if (j < n && _compare(s, b + j * s->size, a + (i - 1) * s->size) < 0) {
+      hi = i - 1;
+    } else {
+      lo = i;
+    }
+  }
+  return lo;
+}
+
+/**
+ * @brief Merges the part [begin, end) of the output of a merge round.
+ *
+ * The range may span several pairs of runs; each pair contributes the slice
+ * of its output that falls into the range.
+ */
+static void _par_sort_merge(void *ctx, usz begin, usz end) {
+  struct _par_sort *par = ctx;
+  struct _sorter const *s = par->s;
+  usz size = s->size;
+  usz pair_size = 2 * par->width;
+
+  for (mut_usz pair = begin - begin % pair_size; pair < end;
+       pair += pair_size) {
+    usz mid = par->count - pair < par->width ? par->count : pair + par->width;
+    usz last = par->count - pair < pair_size ? par->count : pair + pair_size;
+    char *a = par->src + pair * size;
+    char *b = par->src + mid * size;
+    usz m = mid - pair;
+    usz n = last - mid;
+
+    usz d0 = (begin > pair ? begin : pair) - pair;
+    usz d1 = (end < last ? end : last) - pair;
+    mut_usz i = _co_rank(s, a, m, b, n, d0);
+    mut_usz j = d0 - i;
+    usz i_end = _co_rank(s, a, m, b, n, d1);
+    usz j_end = d1 - i_end;
+
+    char *out = par->dst + (pair + d0) * size;
+    while (i < i_end && j < j_end) {
+      char *take = _compare(s, b + j * size, a + i * size) < 0
+                       ? b + j++ * size
+                       : a + i++ * size;
+      memcpy(out, take, size);
+      out += size;
+    }
+    memcpy(out, a + i * size, (i_end - i) * size);
+    out += (i_end - i) * size;
+    memcpy(out, b + j * size, (j_end - j) * size);
+  }
+}
+
+static void _par_sort_copy(void *ctx, usz begin, usz end) {
+  struct _par_sort *par = ctx;
+  usz size = par->s->size;
+  memcpy(par->dst + begin * size, par->src + begin * size,
+         (end - begin) * size);
+}
+
+/**
+ * @brief Sorts runs of the array concurrently and merges them on the pool.
+ *
+ * @param s The array, with contiguous slots.
+ * @param count The number of items.
+ * @param sort_run The sequential sort used on each run.
+ * @param pool The pool, NULL for the default one.
+ */
+static void _par_sort(struct _sorter const *s, usz count,
+                      void (*sort_run)(struct _sorter const *s, usz count),
+                      struct vec_tpool *pool) {
+  struct vec_tpool *workers = pool ? pool : vec_tpool_default();
+  usz threads = vec_tpool_threads(workers);
+  if (threads == 1 || count < VEC_PAR_SORT_MIN) {
+    sort_run(s, count);
+    return;
+  }
+
+  char *tmp = _vec_allocate(s->allocator, count * s->size);
+
+  usz runs = threads < count ? threads : count;
+  struct _par_sort par = {.s = s,
+                          .sort_run = sort_run,
+                          .count = count,
+                          .width = (count + runs - 1) / runs,
+                          .src = s->base,
+                          .dst = tmp};
+  vec_tpool_for(workers, runs, 1, _par_sort_runs, &par);
+
+  usz piece = count / (threads * 8) + 1;
+  for (; par.width < count; par.width *= 2) {
+    vec_tpool_for(workers, count, piece, _par_sort_merge, &par);
+    char *swap = par.src;
+    par.src = par.dst;
+    par.dst = swap;
+  }
+
+  if (par.src != s->base) {
+    par.dst = s->base;
+    vec_tpool_for(workers, count, piece, _par_sort_copy, &par);
+  }
+  _vec_release(s->allocator, tmp, count * s->size);
+}
+
+void vec_par_sort(mut_vec self, int (*cmp)(vec_item a, vec_item b),
+                  struct vec_tpool *pool) {
+  _vec_unshare(self);
+  struct _sorter s = _vec_sorter(self, cmp);
+  _par_sort(&s, self->length, _comparator_run, pool);
+}
+
+void _svec_par_sort(void *svec_ptr, int (*cmp)(vec_item a, vec_item b),
+                    struct vec_tpool *pool) {
+  struct _sorter s = _svec_sorter(svec_ptr, cmp);
+  _par_sort(&s, ((struct _svec_mdi *)svec_ptr)->length, _comparator_run,
+            pool);
+}
+
+/*
+  the runs of numeric sorts are radix sorted, the merges compare the same
+  unsigned keys as the radix sort so that both agree on -0.0 and NaNs
+*/
+#define KEY_UNSIGNED(U, V) (V)
+
+#define PAR_SORT_NUM_DEFINE(T, U, KIND)                                        \
+  static int _cmp_##T(vec_item a, vec_item b) {                                \
+    U x = KEY_##KIND(U, _load_##U(a, 0));                                      \
+    U y = KEY_##KIND(U, _load_##U(b, 0));                                      \
+    return (x > y) - (x < y);                                                  \
+  }                                                                            \
+                                                                               \
+  static void _sort_run_##T(struct _sorter const *s, usz count) {              \
+    vec_sort_##T##_with((mut_##T *)(void *)s->base, count, s->allocator);      \
+  }                                                                            \
+                                                                               \
+  static void _par_sort_##T(mut_##T *data, usz n, struct vec_tpool *pool,      \
+                            vec_allocator *allocator) {                        \
+    struct _sorter s = {.base = (char *)data,                                  \
+                        .step = sizeof(T),                                     \
+                        .size = sizeof(T),                                     \
+                        .indirect = false,                                     \
+                        .cmp = _cmp_##T,                                       \
+                        .allocator = allocator};                               \
+    _par_sort(&s, n, _sort_run_##T, pool);                                     \
+  }                                                                            \
+                                                                               \
+  void vec_par_sort_##T(mut_##T *data, usz n, struct vec_tpool *pool) {        \
+    _par_sort_##T(data, n, pool, NULL);                                        \
+  }                                                                            \
+                                                                               \
+  void _svec_par_sort_##T(void *svec_ptr, struct vec_tpool *pool) {            \
+    struct _svec_mdi *mdi = svec_ptr;                                          \
+    _par_sort_##T((mut_##T *)(void *)(mdi + 1), mdi->length, pool,            \
+                  _svec_derived_allocator(mdi));                               \
+  }
+
+PAR_SORT_NUM_DEFINE(u8, u8, UNSIGNED)
+PAR_SORT_NUM_DEFINE(u16, u16, UNSIGNED)
+PAR_SORT_NUM_DEFINE(u32, u32, UNSIGNED)
+PAR_SORT_NUM_DEFINE(u64, u64, UNSIGNED)
+PAR_SORT_NUM_DEFINE(i8, u8, SIGNED)
+PAR_SORT_NUM_DEFINE(i16, u16, SIGNED)
+PAR_SORT_NUM_DEFINE(i32, u32, SIGNED)
+PAR_SORT_NUM_DEFINE(i64, u64, SIGNED)
+PAR_SORT_NUM_DEFINE(f32, u32, FLOAT)
+PAR_SORT_NUM_DEFINE(f64, u64, FLOAT)
+
+// k-way merging
+
+/**
+ * @struct _kway_head
+ * @brief The next item of one input of a k-way merge.
+ */
+struct _kway_head {
+  mut_usz source; /**< The index of the input. */
+  mut_usz next;   /**< The index of the item in the input. */
+};
+
+/**
+ * @struct _kway
+ * @brief A binary heap of the next items of the inputs, least first.
+ */
+struct _kway {
+  struct _sorter const *sources; /**< The inputs. */
+  usz const *lengths;            /**< The lengths of the inputs. */
+  struct _kway_head *heap;       /**< The heap. */
+  mut_usz size;                  /**< The number of inputs left. */
+};
+
+static vec_item _kway_item(struct _kway const *k, struct _kway_head head) {
+  struct _sorter const *s = &k->sources[head.source];
+  char *slot = _elem(s, head.next);
+  return s->indirect ? *(vec_item *)(void *)slot : slot;
+}
+
+/**
+ * @brief Orders heads by item, then by input so that merging is stable.
+ */
+static bool _kway_less(struct _kway const *k, struct _kway_head x,
+                       struct _kway_head y) {
+  int order = k->sources->cmp(_kway_item(k, x), _kway_item(k, y));
+  return order < 0 || (order == 0 && x.source < y.source);
+}
+
+static void _kway_sift_down(struct _kway *k, mut_usz root) {
+  for (;;) {
+    mut_usz child = 2 * root + 1;
+    if (child >= k->size) {
+      return;
+    }
+
+    if (child + 1 < k->size &&
+        _kway_less(k, k->heap[child + 1], k->heap[child])) {
+      child += 1;
+    }
+
+    if (!_kway_less(k, k->heap[child], k->heap[root])) {
+      return;
+    }
+
+    struct _kway_head swap = k->heap[root];
+    k->heap[root] = k->heap[child];
+    k->heap[child] = swap;
+    root = child;
+  }
+}
+
+/**
+ * @brief Merges sorted arrays, passing their items in order to `emit`.
+ *
+ * @param sources The arrays, all with the same comparator.
+ * @param lengths The lengths of the arrays.
+ * @param count The number of arrays.
+ * @param emit Receives the items in merged order.
+ * @param ctx The context passed to `emit`.
+ */
+static void _kway_merge(struct _sorter const *sources, usz const *lengths,
+                        usz count, void (*emit)(void *ctx, vec_item item),
+                        void *ctx) {
+  struct _kway k = {.sources = sources,
+                    .lengths = lengths,
+                    .heap = malloc(sizeof(struct _kway_head) * count),
+                    .size = 0};
+  if (k.heap == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  for (mut_usz i = 0; i < count; ++i) {
+    if (lengths[i] > 0) {
+      k.heap[k.size++] = (struct _kway_head){.source = i, .next = 0};
+    }
+  }
+
+  for (mut_usz i = k.size / 2; i > 0; --i) {
+    _kway_sift_down(&k, i - 1);
+  }
+
+  while (k.size > 0) {
+    struct _kway_head *top = &k.heap[0];
+    emit(ctx, _kway_item(&k, *top));
+    top->next += 1;
+    if (top->next == lengths[top->source]) {
+      *top = k.heap[--k.size];
+    }
+    _kway_sift_down(&k, 0);
+  }
+
+  free(k.heap);
+}
+
+/**
+ * @struct _merge_out
+ * @brief The destination of a k-way merge.
+ */
+struct _merge_out {
+  mut_vec self; /**< The vector receiving the items. */
+  char *slot;   /**< The next slot of an svec. */
+  mut_usz size; /**< The element size of an svec. */
+};
+
+static void _emit_vec(void *ctx, vec_item item) {
+  struct _merge_out *out = ctx;
+  vec_push(out->self, out->self->interface.flat
+                          ? item
+                          : _vec_clone_item(out->self, item));
+}
+
+static void _emit_svec(void *ctx, vec_item item) {
+  struct _merge_out *out = ctx;
+  memcpy(out->slot, item, out->size);
+  out->slot += out->size;
+}
+
+mut_vec vec_merge_sorted(vec const *vecs, usz count,
+                         int (*cmp)(vec_item a, vec_item b)) {
+  struct _sorter *sources = malloc(sizeof *sources * count);
+  mut_usz *lengths = malloc(sizeof *lengths * count);
+  if (sources == NULL || lengths == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  mut_usz total = 0;
+  for (mut_usz i = 0; i < count; ++i) {
+    sources[i] = _vec_sorter(vecs[i], cmp);
+    lengths[i] = vecs[i]->length;
+    total += lengths[i];
+  }
+
+  struct _merge_out out = {
+      .self = vec_with_capacity(vecs[0]->interface, total)};
+  _kway_merge(sources, lengths, count, _emit_vec, &out);
+
+  free(lengths);
+  free(sources);
+  return out.self;
+}
+
+void *_svec_merge_sorted(void *const *svecs, usz count,
+                         int (*cmp)(vec_item a, vec_item b)) {
+  struct _sorter *sources = malloc(sizeof *sources * count);
+  mut_usz *lengths = malloc(sizeof *lengths * count);
+  if (sources == NULL || lengths == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  mut_usz total = 0;
+  for (mut_usz i = 0; i < count; ++i) {
+    sources[i] = _svec_sorter(svecs[i], cmp);
+    lengths[i] = ((struct _svec_mdi *)svecs[i])->length;
+    total += lengths[i];
+  }
+
+  struct _svec_mdi *first = svecs[0];
+  struct _svec_mdi *data = _svec_with_capacity(
+      first->type_size, total, _svec_derived_allocator(first));
+  struct _merge_out out = {.slot = (char *)(data + 1),
+                           .size = first->type_size};
+  _kway_merge(sources, lengths, count, _emit_svec, &out);
+  data->length = total;
+
+  free(lengths);
+  free(sources);
+  return data;
+}
@@ -0,0 +1,286 @@
+/**
+ * @file vec_sort.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Sorting and binary search for vectors and svecs
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ * Comparators return a negative number, zero or a positive number when the
+ * first item is less than, equal to or greater than the second one. They
+ * receive items as passed to vec_foreach: the item pointers of a vector, or
+ * the addresses of the items of a flat vector or svec.
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "vec_par.h"
+#include "wtfc.h"
+
+/**
+ * @brief Sorts a vector with introsort.
+ *
+ * Quicksort with median-of-three pivots, falling back to heapsort on bad
+ * inputs and to insertion sort on short ranges. Not stable.
+ *
+ * @param self The vector.
+ * @param cmp The comparator.
+ */
+void vec_sort(mut_vec self, int (*cmp)(vec_item a, vec_item b));
+
+/**
+ * @brief Sorts a vector keeping the order of equal items.
+ *
+ * Merge sort using one temporary buffer of the vector's size, taken from its
+ * allocator.
+ *
+ * @param self The vector.
+ * @param cmp The comparator.
+ */
+void vec_stable_sort(mut_vec self, int (*cmp)(vec_item a, vec_item b));
+
+/**
+ * @brief Partially sorts a vector so that the item at `n` is the one that
+ * would be there if the vector were sorted.
+ *
+ * Items before `n` are not greater and items after it are not less than it,
+ * which selects the `n` smallest items for top-k queries.
+ *
+ * @param self The vector.
+ * @param n The index of the item to place.
+ * @param cmp The comparator.
+ */
+void vec_nth_element(mut_vec self, usz n, int (*cmp)(vec_item a, vec_item b));
+
+/**
+ * @brief Finds the first item of a sorted vector not less than a key.
+ *
+ * @param self The sorted vector.
+ * @param key The key, compared as the second argument of `cmp`.
+ * @param cmp The comparator.
+ * @return The index of the item, the length if there is none.
+ */
+mut_usz vec_lower_bound(vec self, vec_item key,
+                        int (*cmp)(vec_item a, vec_item b));
+
+/**
+ * @brief Finds the first item of a sorted vector greater than a key.
+ *
+ * @param self The sorted vector.
+ * @param key The key, compared as the second argument of `cmp`.
+ * @param cmp The comparator.
+ * @return The index of the item, the length if there is none.
+ */
+mut_usz vec_upper_bound(vec self, vec_item key,
+                        int (*cmp)(vec_item a, vec_item b));
+
+/**
+ * @brief Searches a sorted vector for an item equal to a key.
+ *
+ * @param self The sorted vector.
+ * @param key The key, compared as the second argument of `cmp`.
+ * @param cmp The comparator.
+ * @param index Receives the index of the first equal item, may be NULL.
+ * @return True if an equal item was found, false otherwise.
+ */
+bool vec_bsearch(vec self, vec_item key, int (*cmp)(vec_item a, vec_item b),
+                 mut_usz *index);
+
+/**
+ * @brief Sorts an svec with introsort.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @param cmp The comparator, called with element addresses.
+ */
+void _svec_sort(void *svec_ptr, int (*cmp)(vec_item a, vec_item b));
+
+/**
+ * @brief Sorts an svec keeping the order of equal elements.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @param cmp The comparator, called with element addresses.
+ */
+void _svec_stable_sort(void *svec_ptr, int (*cmp)(vec_item a, vec_item b));
+
+/**
+ * @brief Finds the first element of a sorted svec not less than a key.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @param key The address of the key.
+ * @param cmp The comparator, called with element addresses.
+ * @return The index of the element, the length if there is none.
+ */
+mut_usz _svec_lower_bound(void *svec_ptr, vec_item key,
+                          int (*cmp)(vec_item a, vec_item b));
+
+/**
+ * @brief Sorts an svec with a comparator.
+ *
+ * @param SVEC_PTR The pointer to the vector.
+ * @param CMP The comparator, called with element addresses.
+ */
+#define svec_sort(SVEC_PTR, CMP) _svec_sort((SVEC_PTR), (CMP))
+
+/**
+ * @brief Sorts an svec with a comparator, keeping the order of equal
+ * elements.
+ *
+ * @param SVEC_PTR The pointer to the vector.
+ * @param CMP The comparator, called with element addresses.
+ */
+#define svec_stable_sort(SVEC_PTR, CMP) _svec_stable_sort((SVEC_PTR), (CMP))
+
+/**
+ * @brief Finds the first element of a sorted svec not less than a key.
+ *
+ * @param SVEC_PTR The pointer to the vector.
+ * @param KEY The address of the key.
+ * @param CMP The comparator, called with element addresses.
+ * @return The index of the element, the length if there is none.
+ */
+#define svec_lower_bound(SVEC_PTR, KEY, CMP)                                   \
+  _svec_lower_bound((SVEC_PTR), (KEY), (CMP))
+
+/*
+  numeric sorts: vec_sort_<type>(data, n) sorts an array of one of the types
+  below in ascending order without a comparator. Long arrays use an LSD radix
+  sort on the byte representation (signed and floating point values are
+  mapped to order-preserving unsigned keys), skipping bytes that are the same
+  for every element, arrays of up to about 1500 elements an introsort on the
+  same keys. Floating point NaNs are ordered by their bits: negative NaNs
+  first, positive NaNs last. The radix sort takes its counters and a
+  temporary copy of the array from malloc; vec_sort_<type>_with(data, n,
+  allocator) takes them from an allocator.
+*/
+
+/**
+ * @brief Lists the numeric sort types.
+ */
+#define VEC_SORT_TYPES(X)                                                      \
+  X(u8) X(u16) X(u32) X(u64) X(i8) X(i16) X(i32) X(i64) X(f32) X(f64)
+
+#define VEC_SORT_DECLARE(T)                                                    \
+  void vec_sort_##T(mut_##T *data, usz n);                                     \
+  void vec_sort_##T##_with(mut_##T *data, usz n, vec_allocator *allocator);    \
+  void _svec_sort_##T(void *svec_ptr);
+
+VEC_SORT_TYPES(VEC_SORT_DECLARE)
+
+/**
+ * @brief Sorts an svec of a numeric type without a comparator.
+ *
+ * Temporary buffers come from the allocator of the svec, or from malloc for
+ * file-backed svecs and svecs used in place.
+ *
+ * @param TYPE The element type, one of VEC_SORT_TYPES.
+ * @param SVEC_PTR The pointer to the vector.
+ */
+#define svec_sort_num(TYPE, SVEC_PTR) _svec_sort_##TYPE(SVEC_PTR)
+
+// parallel sorting and merging
+
+/**
+ * @brief Vectors shorter than this are sorted on the calling thread.
+ */
+#define VEC_PAR_SORT_MIN 16384
+
+/**
+ * @brief Sorts a vector on a thread pool.
+ *
+ * The buffer is cut into one run per thread, the runs are sorted
+ * concurrently, then merged pairwise; every merge round is split into
+ * independent pieces of the output (found by binary search on the two runs)
+ * so that all threads take part until the end. Uses one temporary buffer of
+ * the vector's size from its allocator. Not stable.
+ *
+ * @param self The vector.
+ * @param cmp The comparator, called concurrently.
+ * @param pool The pool, NULL for vec_tpool_default().
+ */
+void vec_par_sort(mut_vec self, int (*cmp)(vec_item a, vec_item b),
+                  struct vec_tpool *pool);
+
+/**
+ * @brief Sorts an svec on a thread pool.
+ *
+ * @param svec_ptr A pointer to the svec.
+ * @param cmp The comparator, called with element addresses.
+ * @param pool The pool, NULL for vec_tpool_default().
+ */
+void _svec_par_sort(void *svec_ptr, int (*cmp)(vec_item a, vec_item b),
+                    struct vec_tpool *pool);
+
+/**
+ * @brief Sorts an svec with a comparator on a thread pool.
+ *
+ * @param SVEC_PTR The pointer to the vector.
+ * @param CMP The comparator, called with element addresses.
+ * @param POOL The pool, NULL for the default one.
+ */
+#define svec_par_sort(SVEC_PTR, CMP, POOL)                                     \
+  _svec_par_sort((SVEC_PTR), (CMP), (POOL))
+
+/*
+  parallel numeric sorts: vec_par_sort_<type>(data, n, pool) radix sorts one
+  run per thread with vec_sort_<type>, then merges the runs on the pool. The
+  runs take their scratch from malloc, as allocators are not thread-safe;
+  only the merge buffer comes from the allocator, on the calling thread
+*/
+
+#define VEC_PAR_SORT_DECLARE(T)                                                \
+  void vec_par_sort_##T(mut_##T *data, usz n, struct vec_tpool *pool);         \
+  void _svec_par_sort_##T(void *svec_ptr, struct vec_tpool *pool);
+
+VEC_SORT_TYPES(VEC_PAR_SORT_DECLARE)
+
+/**
+ * @brief Sorts an svec of a numeric type on a thread pool.
+ *
+ * @param TYPE The element type, one of VEC_SORT_TYPES.
+ * @param SVEC_PTR The pointer to the vector.
+ * @param POOL The pool, NULL for the default one.
+ */
+#define svec_par_sort_num(TYPE, SVEC_PTR, POOL)                                \
+  _svec_par_sort_##TYPE((SVEC_PTR), (POOL))
+
+/**
+ * @brief Merges sorted vectors into a new sorted vector in one pass.
+ *
+ * Keeps a binary heap of the next item of each input, so merging `count`
+ * vectors of `n` items in total takes O(n log count) comparisons. Equal items
+ * keep the order of their inputs. The result has the interface of the first
+ * vector, the others must hold the same item type; in pointer mode the items
+ * are copied.
+ *
+ * @param vecs The sorted vectors, views included.
+ * @param count The number of vectors, at least one.
+ * @param cmp The comparator the vectors are sorted by.
+ * @return Returns a new vector.
+ */
+mut_vec vec_merge_sorted(vec const *vecs, usz count,
+                         int (*cmp)(vec_item a, vec_item b));
+
+/**
+ * @brief Merges sorted svecs into a new sorted svec in one pass.
+ *
+ * @param svecs Pointers to the svecs, of one element type.
+ * @param count The number of svecs, at least one.
+ * @param cmp The comparator, called with element addresses.
+ * @return A pointer to the new svec, using the allocator of the first one, or
+ * malloc when the first one is file-backed or used in place.
+ */
+void *_svec_merge_sorted(void *const *svecs, usz count,
+                         int (*cmp)(vec_item a, vec_item b));
+
+/**
+ * @brief Merges an array of sorted svecs into a new svec.
+ *
+ * @param SVECS The array of svec pointers.
+ * @param COUNT The number of svecs.
+ * @param CMP The comparator, called with element addresses.
+ * @return The new svec, of the element type of the inputs.
+ */
+#define svec_merge_sorted(SVECS, COUNT, CMP)                                   \
+  _svec_merge_sorted((void *const *)(SVECS), (COUNT), (CMP))
@@ -0,0 +1,442 @@
+#include "vec_sparse.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+
+#define WORD_BITS 64
+#define PAGE_WORDS (VEC_SPARSE_PAGE / WORD_BITS)
+
+/**
+ * @struct _page
+ * @brief The set slots of VEC_SPARSE_PAGE consecutive indices.
+ */
+struct _page {
+  mut_u64 bits[PAGE_WORDS];  /**< One bit per slot, set if it holds an item. */
+  mut_u16 ranks[PAGE_WORDS]; /**< The set slots before each word. */
+  mut_usz number;            /**< The index of the page. */
+  mut_usz count;             /**< The number of items. */
+  mut_usz alloc;             /**< The capacity of `items`. */
+  unsigned char *items;      /**< The items, packed in index order. */
+};
+
+/**
+ * @struct vec_sparse
+ * @brief A sparse vector.
+ */
+struct vec_sparse {
+  struct _page **pages;     /**< The non-empty pages, by page index. */
+  mut_usz page_count;       /**< The number of pages. */
+  mut_usz page_alloc;       /**< The capacity of `pages`. */
+  mut_usz count;            /**< The number of items. */
+  mut_usz item_size;        /**< The size of an item. */
+  vec_allocator *allocator; /**< The allocator, NULL for malloc. */
+};
+
+static mut_usz _popcount(u64 word) {
+#ifdef __GNUC__
+  return (usz)__builtin_popcountll(word);
+#else
+  mut_usz count = 0;
+  for (mut_u64 rest = word; rest != 0; rest &= rest - 1) {
+    count += 1;
+  }
+  return count;
+#endif
+}
+
+static mut_usz _ctz(u64 word) {
+#ifdef __GNUC__
+  return (usz)__builtin_ctzll(word);
+#else
+  mut_usz zeros = 0;
+  for (mut_u64 rest = word; (rest & 1) == 0; rest >>= 1) {
+    zeros += 1;
+  }
+  return zeros;
+#endif
+}
+
+/**
+ * @brief Finds the position of a page in the page directory.
+ *
+ * @param self The vector.
+ * @param number The index of the page.
+ * @return The position of the page, or of the first page after it.
+ */
+static mut_usz _search(struct vec_sparse const *self, usz number) {
+  // slots are usually set in increasing order, check the last page first
+  if (self->page_count == 0 ||
+      self->pages[self->page_count - 1]->number < number) {
+    return self->page_count;
+  }
+
+  mut_usz low = 0;
+  mut_usz high = self->page_count;
+  while (low < high) {
+    usz middle = low + (high - low) / 2;
+    if (self->pages[middle]->number < number) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+static struct _page *_page_of(struct vec_sparse const *self, usz index) {
+  usz number = index / VEC_SPARSE_PAGE;
+  usz position = _search(self, number);
+  return position < self->page_count &&
+                 self->pages[position]->number == number
+             ? self->pages[position]
+             : NULL;
+}
+
+/**
+ * @brief Returns the position of a slot among the items of its page.
+ */
+static mut_usz _rank(struct _page const *page, usz slot) {
+  usz word = slot / WORD_BITS;
+  u64 below = ((u64)1 << (slot % WORD_BITS)) - 1;
+  return page->ranks[word] + _popcount(page->bits[word] & below);
+}
+
+static bool _test(struct _page const *page, usz slot) {
+  return (page->bits[slot / WORD_BITS] >> (slot % WORD_BITS) & 1) != 0;
+}
+
+static bool _is_zero(unsigned char const *bytes, usz size) {
+  for (mut_usz i = 0; i < size; ++i) {
+    if (bytes[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Returns the page of an index, adding it to the directory when
+ * needed.
+ */
+static struct _page *_page_for(struct vec_sparse *self, usz index) {
+  usz number = index / VEC_SPARSE_PAGE;
+  usz position = _search(self, number);
+  if (position < self->page_count &&
+      self->pages[position]->number == number) {
+    return self->pages[position];
+  }
+
+  if (self->page_count == self->page_alloc) {
+    usz alloc =
+        self->page_alloc ? self->page_alloc * 2 : VEC_INITIAL_ALLOC_SIZE;
+    if (alloc > USZ_MAX / sizeof *self->pages) {
+      OUT_OF_MEMORY;
+    }
+
+    self->pages =
+        self->pages == NULL
+            ? _vec_allocate(self->allocator, alloc * sizeof *self->pages)
+            : _vec_reallocate(self->allocator, self->pages,
+                              self->page_alloc * sizeof *self->pages,
+                              alloc * sizeof *self->pages);
+    self->page_alloc = alloc;
+  }
+
+  struct _page *added = _vec_allocate(self->allocator, sizeof *added);
+  memset(added, 0, sizeof *added);
+  added->number = number;
+
+  memmove(self->pages + position + 1, self->pages + position,
+          (self->page_count - position) * sizeof *self->pages);
+  self->pages[position] = added;
+  self->page_count += 1;
+  return added;
+}
+
+static void _free_page(struct vec_sparse *self, struct _page *page) {
+  if (page->items != NULL) {
+    _vec_release(self->allocator, page->items, page->alloc * self->item_size);
+  }
+  _vec_release(self->allocator, page, sizeof *page);
+}
+
+struct vec_sparse *vec_sparse_init(usz item_size) {
+  return vec_sparse_init_with(item_size, NULL);
+}
+
+struct vec_sparse *vec_sparse_init_with(usz item_size,
+                                        vec_allocator *allocator) {
+  if (item_size > USZ_MAX / VEC_SPARSE_PAGE) {
+    OUT_OF_MEMORY;
+  }
+
+  struct vec_sparse *self = _vec_allocate(allocator, sizeof *self);
+  self->pages = NULL;
+  self->page_count = 0;
+  self->page_alloc = 0;
+  self->count = 0;
+  self->item_size = item_size;
+  self->allocator = allocator;
+  return self;
+}
+
+void vec_sparse_destroy(struct vec_sparse *self) {
+  if (self == NULL) {
+    return;
+  }
+
+  for (mut_usz i = 0; i < self->page_count; ++i) {
+    _free_page(self, self->pages[i]);
+  }
+  if (self->pages != NULL) {
+    _vec_release(self->allocator, self->pages,
+                 self->page_alloc * sizeof *self->pages);
+  }
+
+  _vec_release(self->allocator, self, sizeof *self);
+}
+
+mut_usz vec_sparse_count(struct vec_sparse const *self) {
+  return self->count;
+}
+
+mut_usz vec_sparse_extent(struct vec_sparse const *self) {
+  if (self->page_count == 0) {
+    return 0;
+  }
+
+  // pages are freed once empty, so the last page holds the largest index
+  struct _page const *page = self->pages[self->page_count - 1];
+  mut_usz w = PAGE_WORDS - 1;
+  while (page->bits[w] == 0) {
+    w -= 1;
+  }
+
+  u64 word = page->bits[w];
+#ifdef __GNUC__
+  usz top = WORD_BITS - 1 - (usz)__builtin_clzll(word);
+#else
+  mut_usz top = 0;
+  for (mut_u64 rest = word; rest > 1; rest >>= 1) {
+    top += 1;
+  }
+#endif
+  usz last = page->number * VEC_SPARSE_PAGE + w * WORD_BITS + top;
+  return last == USZ_MAX ? USZ_MAX : last + 1;
+}
+
+vec_item vec_sparse_at(struct vec_sparse const *self, usz index) {
+  struct _page const *page = _page_of(self, index);
+  usz slot = index % VEC_SPARSE_PAGE;
+  if (page == NULL || !_test(page, slot)) {
+    return NULL;
+  }
+
+  return page->items + _rank(page, slot) * self->item_size;
+}
+
+bool vec_sparse_contains(struct vec_sparse const *self, usz index) {
+  struct _page const *page = _page_of(self, index);
+  return page != NULL && _test(page, index % VEC_SPARSE_PAGE);
+}
+
+void vec_sparse_set(struct vec_sparse *self, usz index, void const *item) {
+  struct _page *page = _page_for(self, index);
+  usz slot = index % VEC_SPARSE_PAGE;
+  usz size = self->item_size;
+  usz rank = _rank(page, slot);
+  if (_test(page, slot)) {
+    memcpy(page->items + rank * size, item, size);
+    return;
+  }
+
+  if (page->count == page->alloc) {
+    usz alloc = page->alloc ? page->alloc * 2 : VEC_INITIAL_ALLOC_SIZE;
+    page->items =
+        page->items == NULL
+            ? _vec_allocate(self->allocator, alloc * size)
+            : _vec_reallocate(self->allocator, page->items,
+                              page->alloc * size, alloc * size);
+    page->alloc = alloc;
+  }
+
+  memmove(page->items + (rank + 1) * size, page->items + rank * size,
+          (page->count - rank) * size);
+  memcpy(page->items + rank * size, item, size);
+
+  page->bits[slot / WORD_BITS] |= (u64)1 << (slot % WORD_BITS);
+  for (mut_usz w = slot / WORD_BITS + 1; w < PAGE_WORDS; ++w) {
+    page->ranks[w] += 1;
+  }
+  page->count += 1;
+  self->count += 1;
+}
+
+bool vec_sparse_remove(struct vec_sparse *self, usz index) {
+  struct _page *page = _page_of(self, index);
+  usz slot = index % VEC_SPARSE_PAGE;
+  if (page == NULL || !_test(page, slot)) {
+    return false;
+  }
+
+  self->count -= 1;
+  if (page->count == 1) {
+    usz position = _search(self, page->number);
+    memmove(self->pages + position, self->pages + position + 1,
+            (self->page_count - position - 1) * sizeof *self->pages);
+    self->page_count -= 1;
+    _free_page(self, page);
+    return true;
+  }
+
+  usz size = self->item_size;
+  usz rank = _rank(page, slot);
+  memmove(page->items + rank * size, page->items + (rank + 1) * size,
+          (page->count - rank - 1) * size);
+
+  page->bits[slot / WORD_BITS] &= ~((u64)1 << (slot % WORD_BITS));
+  for (mut_usz w = slot / WORD_BITS + 1; w < PAGE_WORDS; ++w) {
+    page->ranks[w] -= 1;
+  }
+  page->count -= 1;
+  return true;
+}
+
+mut_usz vec_sparse_rank(struct vec_sparse const *self, usz index) {
+  usz number = index / VEC_SPARSE_PAGE;
+  usz position = _search(self, number);
+  mut_usz rank = 0;
+  for (mut_usz i = 0; i < position; ++i) {
+    rank += self->pages[i]->count;
+  }
+
+  if (position < self->page_count &&
+      self->pages[position]->number == number) {
+    rank += _rank(self->pages[position], index % VEC_SPARSE_PAGE);
+  }
+  return rank;
+}
+
+bool vec_sparse_next(struct vec_sparse const *self, usz from,
+                     mut_usz *index) {
+  usz first = from / VEC_SPARSE_PAGE;
+  for (mut_usz i = _search(self, first); i < self->page_count; ++i) {
+    struct _page const *page = self->pages[i];
+
+    // only the page of `from` starts inside a word
+    usz start = page->number == first ? from % VEC_SPARSE_PAGE : 0;
+    for (mut_usz w = start / WORD_BITS; w < PAGE_WORDS; ++w) {
+      mut_u64 word = page->bits[w];
+      if (w == start / WORD_BITS) {
+        word &= ~(u64)0 << (start % WORD_BITS);
+      }
+      if (word != 0) {
+        *index = page->number * VEC_SPARSE_PAGE + w * WORD_BITS + _ctz(word);
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void vec_sparse_foreach_ctx(struct vec_sparse const *self,
+                            void (*apply)(void *ctx, usz index,
+                                          vec_item item),
+                            void *ctx) {
+  for (mut_usz i = 0; i < self->page_count; ++i) {
+    struct _page const *page = self->pages[i];
+    unsigned char *item = page->items;
+    for (mut_usz w = 0; w < PAGE_WORDS; ++w) {
+      for (mut_u64 word = page->bits[w]; word != 0; word &= word - 1) {
+        apply(ctx, page->number * VEC_SPARSE_PAGE + w * WORD_BITS + _ctz(word),
+              item);
+        item += self->item_size;
+      }
+    }
+  }
+}
+
+struct vec_sparse *vec_sparse_from_svec(void const *svec_ptr) {
+  struct _svec_mdi const *mdi = svec_ptr;
+  usz size = mdi->type_size;
+  unsigned char const *items = (unsigned char const *)(mdi + 1);
+
+  struct vec_sparse *self =
+      vec_sparse_init_with(size, _svec_derived_allocator(svec_ptr));
+  for (mut_usz i = 0; i < mdi->length; ++i) {
+    if (!_is_zero(items + i * size, size)) {
+      vec_sparse_set(self, i, items + i * size);
+    }
+  }
+
+  return self;
+}
+
+/**
+ * @brief Copies the items into a zeroed dense buffer of extent items.
+ *
+ * @param self The vector.
+ * @param items The dense buffer.
+ */
+static void _scatter(struct vec_sparse const *self, unsigned char *items) {
+  usz size = self->item_size;
+  for (mut_usz i = 0; i < self->page_count; ++i) {
+    struct _page const *page = self->pages[i];
+    unsigned char const *item = page->items;
+    for (mut_usz w = 0; w < PAGE_WORDS; ++w) {
+      for (mut_u64 word = page->bits[w]; word != 0; word &= word - 1) {
+        usz index = page->number * VEC_SPARSE_PAGE + w * WORD_BITS + _ctz(word);
+        memcpy(items + index * size, item, size);
+        item += size;
+      }
+    }
+  }
+}
+
+void *vec_sparse_to_svec(struct vec_sparse const *self) {
+  usz extent = vec_sparse_extent(self);
+  usz size = self->item_size;
+  struct _svec_mdi *mdi = _svec_with_capacity(size, extent, self->allocator);
+  unsigned char *items = (unsigned char *)(mdi + 1);
+  if (extent != 0 && size != 0) {
+    memset(items, 0, extent * size);
+  }
+
+  _scatter(self, items);
+  mdi->length = extent;
+  return mdi;
+}
+
+struct vec_sparse *vec_sparse_from_vec(vec other) {
+  usz size = _slot_size(other);
+  struct vec_sparse *self =
+      vec_sparse_init_with(size, other->interface.allocator);
+  for (mut_usz i = 0; i < other->length; ++i) {
+    char const *slot = _slot(other, i);
+    if (!_is_zero((unsigned char const *)slot, size)) {
+      vec_sparse_set(self, i, slot);
+    }
+  }
+
+  return self;
+}
+
+mut_vec vec_sparse_to_vec(struct vec_sparse const *self,
+                          vec_interface interface) {
+  usz size = interface.flat ? interface.item_size : sizeof(vec_item);
+  if (size != self->item_size) {
+    return NULL;
+  }
+
+  // scatter straight into the new vector instead of through a dense svec
+  usz extent = vec_sparse_extent(self);
+  mut_vec result = vec_with_capacity(interface, extent);
+  if (extent != 0 && size != 0) {
+    memset(result->elements, 0, extent * size);
+  }
+
+  _scatter(self, result->elements);
+  result->length = extent;
+  VEC_STAT(_vec_stats_push(result, extent));
+  return result;
+}
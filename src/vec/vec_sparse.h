@@ -0,0 +1,205 @@
+/**
+ * @file vec_sparse.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Sparse vector for mostly empty index spaces
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @struct  vec_sparse
+ * @brief A vector of items stored by value at arbitrary indices.
+ *
+ * The index space is cut into pages of VEC_SPARSE_PAGE slots. A page exists
+ * once one of its slots is set and holds a bitmap of its set slots, the
+ * number of set slots before each bitmap word, and its items packed in
+ * index order. The pages are kept sorted by index in a directory, so memory
+ * grows with the number of items, whatever the largest index, and iterating
+ * skips empty slots a word at a time. Finding an item is a binary search
+ * over the pages, a bitmap test and a popcount: access is O(log pages)
+ * rather than O(1), except for the last page, which is checked first so
+ * that filling the vector in index order stays O(1) per item. Adding or
+ * freeing a page also moves the later entries of the directory.
+ */
+struct vec_sparse;
+
+/**
+ * @brief Number of slots of a page.
+ */
+#define VEC_SPARSE_PAGE 4096
+
+/**
+ * @brief Initializes a sparse vector using malloc.
+ *
+ * @param item_size The size of an item.
+ * @return Returns a new sparse vector.
+ */
+struct vec_sparse *vec_sparse_init(usz item_size);
+
+/**
+ * @brief Initializes a sparse vector using a custom allocator.
+ *
+ * @param item_size The size of an item.
+ * @param allocator The allocator for the vector and its pages, NULL for
+ * malloc.
+ * @return Returns a new sparse vector.
+ */
+struct vec_sparse *vec_sparse_init_with(usz item_size,
+                                        vec_allocator *allocator);
+
+/**
+ * @brief Frees a sparse vector and its pages.
+ *
+ * @param self The vector, may be NULL.
+ */
+void vec_sparse_destroy(struct vec_sparse *self);
+
+/**
+ * @brief Get the number of items in the vector.
+ *
+ * @param self The vector.
+ * @return The number of set slots.
+ */
+mut_usz vec_sparse_count(struct vec_sparse const *self);
+
+/**
+ * @brief Get the length of the dense equivalent of the vector.
+ *
+ * @param self The vector.
+ * @return One past the largest set index, 0 if the vector is empty, and
+ * USZ_MAX when the index USZ_MAX is set.
+ */
+mut_usz vec_sparse_extent(struct vec_sparse const *self);
+
+/**
+ * @brief Returns the item at an index.
+ *
+ * Takes O(log pages). The address stays valid until a slot of the same page
+ * is set or removed.
+ *
+ * @param self The vector.
+ * @param index The index of the item.
+ * @return The address of the item, NULL if the slot is empty.
+ */
+vec_item vec_sparse_at(struct vec_sparse const *self, usz index);
+
+/**
+ * @brief Checks whether a slot holds an item.
+ *
+ * @param self The vector.
+ * @param index The index of the slot.
+ * @return True if the slot is set, false otherwise.
+ */
+bool vec_sparse_contains(struct vec_sparse const *self, usz index);
+
+/**
+ * @brief Stores a copy of an item at an index, replacing any previous one.
+ *
+ * Takes O(log pages) to find the page. Setting an empty slot moves the
+ * later items of its page, at most VEC_SPARSE_PAGE of them, and adding a
+ * page moves the later entries of the directory.
+ *
+ * @param self The vector.
+ * @param index The index of the slot.
+ * @param item The address of the item.
+ */
+void vec_sparse_set(struct vec_sparse *self, usz index, void const *item);
+
+/**
+ * @brief Empties a slot, freeing its page when it was the last item.
+ *
+ * @param self The vector.
+ * @param index The index of the slot.
+ * @return True if an item was removed, false if the slot was empty.
+ */
+bool vec_sparse_remove(struct vec_sparse *self, usz index);
+
+/**
+ * @brief Counts the set slots below an index.
+ *
+ * Sums the counts of the earlier pages, then popcounts within the page.
+ *
+ * @param self The vector.
+ * @param index The index.
+ * @return The number of set slots before `index`.
+ */
+mut_usz vec_sparse_rank(struct vec_sparse const *self, usz index);
+
+/**
+ * @brief Finds the first set slot at or after an index.
+ *
+ * @param self The vector.
+ * @param from The index to start from.
+ * @param index Receives the index of the set slot.
+ * @return True if a slot was found, false otherwise.
+ */
+bool vec_sparse_next(struct vec_sparse const *self, usz from,
+                     mut_usz *index);
+
+/**
+ * @brief Applies a function to each item with its index, in index order.
+ *
+ * Empty slots are skipped a bitmap word at a time.
+ *
+ * @param self The vector.
+ * @param apply The function receiving the index and the item.
+ * @param ctx The context passed to `apply`.
+ */
+void vec_sparse_foreach_ctx(struct vec_sparse const *self,
+                            void (*apply)(void *ctx, usz index,
+                                          vec_item item),
+                            void *ctx);
+
+/**
+ * @brief Builds a sparse vector from the items of an svec.
+ *
+ * Items whose bytes are all zero are treated as empty slots.
+ *
+ * @param svec_ptr The svec.
+ * @return Returns a new sparse vector using the allocator of the svec, or
+ * malloc for file-backed svecs and svecs used in place.
+ */
+struct vec_sparse *vec_sparse_from_svec(void const *svec_ptr);
+
+/**
+ * @brief Builds a dense svec from a sparse vector.
+ *
+ * @param self The vector.
+ * @return Returns a new svec of vec_sparse_extent items, empty slots zeroed.
+ * Exits when out of memory, as when the largest set index is USZ_MAX.
+ */
+void *vec_sparse_to_svec(struct vec_sparse const *self);
+
+/**
+ * @brief Builds a sparse vector from the slots of a vector.
+ *
+ * Holds the items by value in flat mode and the item pointers otherwise,
+ * so the vector keeps owning its items. NULL items, and flat items whose
+ * bytes are all zero, are treated as empty slots.
+ *
+ * @param other The vector.
+ * @return Returns a new sparse vector.
+ */
+struct vec_sparse *vec_sparse_from_vec(vec other);
+
+/**
+ * @brief Builds a dense vector from a sparse vector.
+ *
+ * Empty slots become zeroed items in flat mode and NULL items otherwise.
+ * When the interface destroys items, the new vector owns the pointers held
+ * by the sparse vector, and `destroy` must accept NULL.
+ *
+ * @param self The vector.
+ * @param interface The interface of the new vector, whose slots must have
+ * the size of the items of `self`.
+ * @return Returns a new vector, NULL if the slot sizes differ.
+ */
+mut_vec vec_sparse_to_vec(struct vec_sparse const *self,
+                          vec_interface interface);
@@ -0,0 +1,226 @@
+#include "vec_stats.h"
+#include "vec_impl.h"
+#include "wtfc.h"
+
+#ifdef VEC_STATS
+#include <pthread.h>
+#include <stdatomic.h>
+
+/**
+ * @struct _vec_stats_node
+ * @brief The counters of a vector, linked into the list of live vectors.
+ *
+ * Updated like the vector itself, without synchronization.
+ */
+struct _vec_stats_node {
+  struct vec_stats stats;       /**< The event counters. */
+  vec owner;                    /**< The vector. */
+  struct _vec_stats_node *prev; /**< The previous live vector. */
+  struct _vec_stats_node *next; /**< The next live vector. */
+};
+
+/**
+ * @struct _vec_stats_global
+ * @brief The global event counters, as in struct vec_stats.
+ */
+struct _vec_stats_global {
+  atomic_uint_fast64_t pushes;
+  atomic_uint_fast64_t reallocs;
+  atomic_uint_fast64_t bytes_moved;
+  atomic_uint_fast64_t copies;
+  atomic_uint_fast64_t unshares;
+  atomic_uint_fast64_t item_copies;
+  atomic_uint_fast64_t peak_capacity;
+};
+
+static struct _vec_stats_global global;
+
+static pthread_mutex_t live_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct _vec_stats_node *live = NULL;
+
+static void _add(atomic_uint_fast64_t *counter, usz count) {
+  atomic_fetch_add_explicit(counter, count, memory_order_relaxed);
+}
+
+static void _raise(atomic_uint_fast64_t *peak, usz value) {
+  uint_fast64_t seen = atomic_load_explicit(peak, memory_order_relaxed);
+  while (seen < value &&
+         !atomic_compare_exchange_weak_explicit(peak, &seen, value,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+}
+
+void _vec_stats_track(mut_vec self) {
+  struct _vec_stats_node *node = calloc(1, sizeof *node);
+  if (node == NULL) {
+    OUT_OF_MEMORY;
+  }
+
+  node->owner = self;
+  node->stats.peak_capacity = _slot_size(self) * self->alloc;
+  _raise(&global.peak_capacity, node->stats.peak_capacity);
+  self->stats = node;
+
+  pthread_mutex_lock(&live_lock);
+  node->next = live;
+  if (live != NULL) {
+    live->prev = node;
+  }
+  live = node;
+  pthread_mutex_unlock(&live_lock);
+}
+
+void _vec_stats_untrack(mut_vec self) {
+  struct _vec_stats_node *node = self->stats;
+  if (node == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&live_lock);
+  if (node->prev != NULL) {
+    node->prev->next = node->next;
+  } else {
+    live = node->next;
+  }
+  if (node->next != NULL) {
+    node->next->prev = node->prev;
+  }
+  pthread_mutex_unlock(&live_lock);
+
+  self->stats = NULL;
+  free(node);
+}
+
+void _vec_stats_push(vec self, usz count) {
+  _add(&global.pushes, count);
+  if (self != NULL && self->stats != NULL) {
+    self->stats->stats.pushes += count;
+  }
+}
+
+void _vec_stats_resize(vec self, usz moved, usz capacity) {
+  _add(&global.reallocs, 1);
+  _add(&global.bytes_moved, moved);
+  _raise(&global.peak_capacity, capacity);
+  if (self != NULL && self->stats != NULL) {
+    struct vec_stats *stats = &self->stats->stats;
+    stats->reallocs += 1;
+    stats->bytes_moved += moved;
+    if (stats->peak_capacity < capacity) {
+      stats->peak_capacity = capacity;
+    }
+  }
+}
+
+void _vec_stats_copy(vec self) {
+  _add(&global.copies, 1);
+  if (self->stats != NULL) {
+    self->stats->stats.copies += 1;
+  }
+}
+
+void _vec_stats_unshare(vec self) {
+  _add(&global.unshares, 1);
+  if (self->stats != NULL) {
+    self->stats->stats.unshares += 1;
+  }
+}
+
+void _vec_stats_item_copy(vec self) {
+  _add(&global.item_copies, 1);
+  if (self->stats != NULL) {
+    self->stats->stats.item_copies += 1;
+  }
+}
+#endif
+
+/**
+ * @brief Fills in the capacity of a vector, counting the small buffer.
+ *
+ * @param self The vector.
+ * @param stats The snapshot to fill.
+ */
+static void _fill_capacity(vec self, struct vec_stats *stats) {
+  usz slot_size = _slot_size(self);
+  stats->capacity = slot_size * self->alloc;
+  stats->wasted = slot_size * (self->alloc - self->length);
+  stats->vectors = 1;
+}
+
+bool vec_stats_enabled(void) {
+#ifdef VEC_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void vec_stats_get(vec self, struct vec_stats *stats) {
+  *stats = (struct vec_stats){0};
+#ifdef VEC_STATS
+  if (self->stats != NULL) {
+    *stats = self->stats->stats;
+  }
+#endif
+  _fill_capacity(self, stats);
+}
+
+void vec_stats_global(struct vec_stats *stats) {
+  *stats = (struct vec_stats){0};
+#ifdef VEC_STATS
+  stats->pushes = atomic_load_explicit(&global.pushes, memory_order_relaxed);
+  stats->reallocs =
+      atomic_load_explicit(&global.reallocs, memory_order_relaxed);
+  stats->bytes_moved =
+      atomic_load_explicit(&global.bytes_moved, memory_order_relaxed);
+  stats->copies = atomic_load_explicit(&global.copies, memory_order_relaxed);
+  stats->unshares =
+      atomic_load_explicit(&global.unshares, memory_order_relaxed);
+  stats->item_copies =
+      atomic_load_explicit(&global.item_copies, memory_order_relaxed);
+  stats->peak_capacity =
+      atomic_load_explicit(&global.peak_capacity, memory_order_relaxed);
+
+  // the lock only guards the list, the vectors must be quiescent
+  pthread_mutex_lock(&live_lock);
+  for (struct _vec_stats_node *node = live; node != NULL; node = node->next) {
+    struct vec_stats one;
+    _fill_capacity(node->owner, &one);
+    stats->capacity += one.capacity;
+    stats->wasted += one.wasted;
+    stats->vectors += 1;
+  }
+  pthread_mutex_unlock(&live_lock);
+#endif
+}
+
+void vec_stats_reset(void) {
+#ifdef VEC_STATS
+  atomic_store_explicit(&global.pushes, 0, memory_order_relaxed);
+  atomic_store_explicit(&global.reallocs, 0, memory_order_relaxed);
+  atomic_store_explicit(&global.bytes_moved, 0, memory_order_relaxed);
+  atomic_store_explicit(&global.copies, 0, memory_order_relaxed);
+  atomic_store_explicit(&global.unshares, 0, memory_order_relaxed);
+  atomic_store_explicit(&global.item_copies, 0, memory_order_relaxed);
+  atomic_store_explicit(&global.peak_capacity, 0, memory_order_relaxed);
+#endif
+}
+
+void vec_stats_foreach(void (*visit)(void *ctx, vec self,
+                                     struct vec_stats const *stats),
+                       void *ctx) {
+#ifdef VEC_STATS
+  // the lock only guards the list, the vectors must be quiescent
+  pthread_mutex_lock(&live_lock);
+  for (struct _vec_stats_node *node = live; node != NULL; node = node->next) {
+    struct vec_stats stats = node->stats;
+    _fill_capacity(node->owner, &stats);
+    visit(ctx, node->owner, &stats);
+  }
+  pthread_mutex_unlock(&live_lock);
+#else
+  (void)visit;
+  (void)ctx;
+#endif
+}
@@ -0,0 +1,90 @@
+/**
+ * @file vec_stats.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Opt-in allocation and hot path counters
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ * Counters are only collected when the library is built with VEC_STATS
+ * defined (the VEC_STATS CMake option), otherwise the hooks compile to
+ * nothing and the functions below report zeros. Each vector counts its own
+ * events; svecs and typed vectors have no room for counters and only add to
+ * the global ones. With the counters on, every vector other than a view is
+ * registered as live until vec_destroy, including those made by vec_init_in.
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+
+/**
+ * @struct  vec_stats
+ * @brief A snapshot of the counters of one vector or of the whole library.
+ */
+struct vec_stats {
+  mut_u64 pushes;        /**< Items pushed, extended or inserted. */
+  mut_u64 reallocs;      /**< Resizes of the element buffer. */
+  mut_u64 bytes_moved;   /**< Bytes of items carried over by resizes. */
+  mut_u64 copies;        /**< Copies, slices and maps made of the vector. */
+  mut_u64 unshares;      /**< Shared buffers duplicated before a write. */
+  mut_u64 item_copies;   /**< Items allocated by copies in pointer mode. */
+  mut_u64 peak_capacity; /**< The largest element buffer, in bytes. */
+  mut_u64 capacity;      /**< The current element buffers, in bytes. */
+  mut_u64 wasted;        /**< Bytes of capacity not holding items. */
+  mut_u64 vectors;       /**< Live vectors, 1 for a single vector. */
+};
+
+/**
+ * @brief Tells whether the library was built with the counters.
+ *
+ * @return True if the counters are collected, false otherwise.
+ */
+bool vec_stats_enabled(void);
+
+/**
+ * @brief Takes a snapshot of the counters of one vector.
+ *
+ * The capacity and wasted bytes are filled in even without the counters.
+ * Views have no counters of their own.
+ *
+ * @param self The vector.
+ * @param stats Receives the snapshot.
+ */
+void vec_stats_get(vec self, struct vec_stats *stats);
+
+/**
+ * @brief Takes a snapshot of the global counters.
+ *
+ * Event counters add up every vector, svec and typed vector since the last
+ * reset; capacity, wasted and vectors sum up the live vectors. The event
+ * counters are atomic and may be read at any time, but capacity and wasted
+ * are read from the live vectors themselves: they are only valid while no
+ * other thread modifies a tracked vector, and are a data race otherwise.
+ *
+ * @param stats Receives the snapshot.
+ */
+void vec_stats_global(struct vec_stats *stats);
+
+/**
+ * @brief Resets the global event counters and peak capacity.
+ */
+void vec_stats_reset(void);
+
+/**
+ * @brief Visits every live vector with a snapshot of its counters.
+ *
+ * Used to find vectors with too much slack or too many resizes. Vectors must
+ * not be created or destroyed from `visit`. Each snapshot is read from the
+ * vector and its unsynchronized counters, so this is only valid while no
+ * other thread modifies a tracked vector, e.g. between phases of a program
+ * or once its workers have been joined.
+ *
+ * @param visit The function called for each vector.
+ * @param ctx The context passed to `visit`.
+ */
+void vec_stats_foreach(void (*visit)(void *ctx, vec self,
+                                     struct vec_stats const *stats),
+                       void *ctx);
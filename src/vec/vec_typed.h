@@ -0,0 +1,146 @@
+/**
+ * @file vec_typed.h
+ * @author ezeire (ognieff@yandex.ru)
+ * @brief Type-specialized vectors generated by macros
+ * @version 0.1
+ * @date 2023-10-22
+ *
+ * @copyright Copyright (c) 2023 ezeire
+ *
+ */
+
+#pragma once
+#include "vec.h"
+#include "wtfc.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Grows the buffer of a typed vector.
+ *
+ * Out of line slow path of the generated push functions, exits when out of
+ * memory.
+ *
+ * @param data The buffer, may be NULL.
+ * @param alloc The capacity of the buffer, updated to the new capacity.
+ * @param needed The minimal capacity required.
+ * @param item_size The size of an item.
+ * @return The grown buffer.
+ */
+void *_vec_typed_grow(void *data, mut_usz *alloc, usz needed, usz item_size);
+
+/**
+ * @brief Loops over the items of a typed vector.
+ *
+ * Expands to a plain pointer loop the compiler can unroll and vectorize.
+ *
+ * @param TYPE The mutable item type of the vector.
+ * @param SELF The pointer to the typed vector.
+ * @param ITEM The name of the item pointer inside the loop.
+ */
+#define VEC_FOREACH(TYPE, SELF, ITEM)                                          \
+  for (TYPE *ITEM = (SELF)->data, *ITEM##_end = (SELF)->data + (SELF)->length; \
+       ITEM != ITEM##_end; ++ITEM)
+
+/**
+ * @brief Defines a vector of a `wtfc.h` type, e.g. `VEC_DEFINE(i32)`.
+ *
+ * Emits `struct vec_i32` and `vec_i32_*` functions storing `mut_i32` items.
+ *
+ * @param T The name of the type alias, without the `mut_` prefix.
+ */
+#define VEC_DEFINE(T) VEC_DEFINE_TYPE(T, mut_##T)
+
+/**
+ * @brief Defines a vector named `vec_NAME` of items of type `TYPE`.
+ *
+ * The vector is a value type holding a contiguous buffer, so it can live on
+ * the stack or inside another struct. Every function is `static inline` with
+ * the item size known at compile time. Start from `vec_NAME_init()` and
+ * release the buffer with `vec_NAME_destroy()`.
+ *
+ * @param NAME The suffix of the generated names.
+ * @param TYPE The mutable item type.
+ */
+#define VEC_DEFINE_TYPE(NAME, TYPE)                                            \
+  typedef struct vec_##NAME {                                                  \
+    TYPE *data;     /**< The items. */                                         \
+    mut_usz length; /**< The number of items. */                               \
+    mut_usz alloc;  /**< The capacity of the buffer. */                        \
+  } vec_##NAME;                                                                \
+                                                                               \
+  static inline vec_##NAME vec_##NAME##_init(void) {                           \
+    return (vec_##NAME){.data = NULL, .length = 0, .alloc = 0};                \
+  }                                                                            \
+                                                                               \
+  static inline void vec_##NAME##_destroy(vec_##NAME *self) {                  \
+    free(self->data);                                                          \
+    *self = vec_##NAME##_init();                                               \
+  }                                                                            \
+                                                                               \
+  static inline mut_usz vec_##NAME##_length(vec_##NAME const *self) {         \
+    return self->length;                                                       \
+  }                                                                            \
+                                                                               \
+  static inline bool vec_##NAME##_empty(vec_##NAME const *self) {             \
+    return self->length == 0;                                                  \
+  }                                                                            \
+                                                                               \
+  static inline void vec_##NAME##_reserve(vec_##NAME *self, usz capacity) {   \
+    if (capacity > self->alloc) {                                              \
+      self->data =                                                             \
+          _vec_typed_grow(self->data, &self->alloc, capacity, sizeof(TYPE));   \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static inline void vec_##NAME##_push(vec_##NAME *self, TYPE value) {        \
+    if (self->length == self->alloc) {                                         \
+      self->data = _vec_typed_grow(self->data, &self->alloc,                   \
+                                   self->length + 1, sizeof(TYPE));            \
+    }                                                                          \
+    self->data[self->length++] = value;                                        \
+  }                                                                            \
+                                                                               \
+  static inline void vec_##NAME##_extend(vec_##NAME *self,                     \
+                                         TYPE const *items, usz count) {       \
+    if (self->alloc - self->length < count) {                                  \
+      self->data = _vec_typed_grow(self->data, &self->alloc,                   \
+                                   self->length + count, sizeof(TYPE));        \
+    }                                                                          \
+    if (count) {                                                               \
+      memcpy(self->data + self->length, items, count * sizeof(TYPE));          \
+    }                                                                          \
+    self->length += count;                                                     \
+  }                                                                            \
+                                                                               \
+  static inline bool vec_##NAME##_pop(vec_##NAME *self) {                      \
+    if (self->length == 0) {                                                   \
+      return false;                                                            \
+    }                                                                          \
+    --self->length;                                                            \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  static inline TYPE vec_##NAME##_at(vec_##NAME const *self, usz index) {     \
+    return self->data[index];                                                  \
+  }                                                                            \
+                                                                               \
+  static inline TYPE *vec_##NAME##_ptr(vec_##NAME const *self, usz index) {   \
+    return self->data + index;                                                 \
+  }                                                                            \
+                                                                               \
+  static inline bool vec_##NAME##_set(vec_##NAME *self, usz index,            \
+                                      TYPE value) {                            \
+    if (index >= self->length) {                                               \
+      return false;                                                            \
+    }                                                                          \
+    self->data[index] = value;                                                 \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  static inline void vec_##NAME##_foreach(vec_##NAME const *self,              \
+                                          void (*apply)(TYPE * item)) {        \
+    VEC_FOREACH(TYPE, self, item) { apply(item); }                             \
+  }                                                                            \
+                                                                               \
+  static inline void vec_##NAME##_clear(vec_##NAME *self) { self->length = 0; }